@@ -0,0 +1,121 @@
+/*
+ * @file        : compresscache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "compresscache.h"
+#include "../http/httpresponse.h"
+
+CompressCache* CompressCache::Instance() {
+    static CompressCache cache;
+    return &cache;
+}
+
+CompressCache::CompressCache() 
+    : level_(Z_DEFAULT_COMPRESSION), minSize_(0), maxSize_(0), capacity_(0), used_(0), hits_(0), misses_(0) {}
+
+void CompressCache::init(int level, size_t minSize, size_t maxSize, size_t capacity) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    level_ = level;
+    minSize_ = minSize;
+    maxSize_ = maxSize;
+    capacity_ = capacity;
+    while(used_ > capacity_ && !lru_.empty())
+        erase_(lru_.back());
+}
+
+bool CompressCache::isSupported(const std::string& coding) {
+    return coding == "gzip" || coding == "deflate";
+}
+
+bool CompressCache::compress(const char* data, size_t len, const std::string& coding, int level, std::string& out) {
+    if(!isSupported(coding))
+        return false;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 16 + MAX_WBITS for the gzip wrapper, MAX_WBITS alone for the zlib wrapper ("deflate" in HTTP)
+    int windowBits = coding == "gzip" ? 16 + MAX_WBITS : MAX_WBITS;
+    if(deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    out.resize(deflateBound(&stream, len));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = len;
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = out.size();
+    int ret = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END;
+}
+
+size_t CompressCache::entrySize_(const std::string& key, const Entry& entry) {
+    return key.size() + entry.header.size() + entry.body.size();
+}
+
+std::shared_ptr<const CompressCache::Entry> CompressCache::get(const std::string& path, const OpenFile& file, const std::string& coding) {
+    size_t fileSize = file.st.st_size;
+    std::string key = path + "|" + coding + "|" + std::to_string(file.st.st_mtim.tv_sec) 
+                    + "." + std::to_string(file.st.st_mtim.tv_nsec) + "|" + std::to_string(fileSize);
+    int level;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(fileSize < minSize_ || fileSize > maxSize_)
+            return nullptr;
+        auto it = entries_.find(key);
+        if(it != entries_.end()) {
+            hits_++;
+            lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+            return it->second.entry;
+        }
+        level = level_;
+    }
+    misses_++;
+
+    // Read and compress the file without holding the lock.
+    std::string content(fileSize, '\0');
+    size_t total = 0;
+    while(total < fileSize) {
+        ssize_t len = pread(file.fd, &content[total], fileSize - total, total);
+        if(len <= 0)
+            break;
+        total += len;
+    }
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    if(total != fileSize || !compress(content.data(), content.size(), coding, level, entry->body)) {
+        LOG_WARN("CompressCache: failed to compress %s", path.c_str());
+        return nullptr;
+    }
+    entry->etag = HttpResponse::makeETag(file.st, coding);
+    entry->lastModified = file.st.st_mtime;
+    entry->header = "Content-Type: " + HttpResponse::fileType(path) + "\r\n";
+    entry->header += "Content-Encoding: " + coding + "\r\n";
+    entry->header += "Content-Length: " + std::to_string(entry->body.size()) + "\r\n";
+    entry->header += "ETag: " + entry->etag + "\r\n";
+    entry->header += "Last-Modified: " + HttpResponse::httpDate(entry->lastModified) + "\r\n";
+    LOG_DEBUG("CompressCache: %s %s %zu -> %zu bytes", path.c_str(), coding.c_str(), fileSize, entry->body.size());
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    size_t size = entrySize_(key, *entry);
+    if(size > capacity_)
+        return entry;
+    if(entries_.count(key))
+        erase_(key);
+    while(used_ + size > capacity_ && !lru_.empty())
+        erase_(lru_.back());
+    lru_.push_front(key);
+    entries_[key] = { entry, lru_.begin() };
+    used_ += size;
+    return entry;
+}
+
+void CompressCache::erase_(const std::string& key) {
+    auto it = entries_.find(key);
+    if(it == entries_.end())
+        return;
+    auto lruIt = it->second.lruIt;
+    used_ -= entrySize_(key, *it->second.entry);
+    entries_.erase(it);
+    lru_.erase(lruIt);  // The key may refer to this node, so it goes last.
+}
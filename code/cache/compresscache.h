@@ -0,0 +1,104 @@
+/*
+ * @file        : compresscache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the CompressCache class, which is designed 
+ *                for compressing responses on the fly with zlib and keeping the compressed bytes 
+ *                in memory, so that each version of a resource is compressed only once.
+ */
+
+#ifndef COMPRESS_CACHE_H
+#define COMPRESS_CACHE_H
+
+#include <zlib.h>
+#include <unistd.h>      // pread
+#include <string>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "fdcache.h"
+#include "staticcache.h"
+#include "../log/log.h"
+
+/**
+ * @class CompressCache
+ * @brief The CompressCache class is used to cache compressed static resources.
+ * 
+ * Entries are keyed by (path, mtime, content-coding), so a modified file simply 
+ * misses and its old versions age out in LRU order under the memory cap. The 
+ * entries have the same layout as StaticCache entries and are served from memory.
+ */
+class CompressCache {
+public:
+    using Entry = StaticCache::Entry;
+
+    static CompressCache* Instance();
+
+    /**
+     * @brief Set the options of the compression and the limits of the cache.
+     * @param level The zlib compression level (1-9).
+     * @param minSize Files smaller than it are not compressed.
+     * @param maxSize Files larger than it are not compressed (0 to disable).
+     * @param capacity The memory cap of all entries in bytes.
+     */
+    void init(int level, size_t minSize, size_t maxSize, size_t capacity);
+
+    /**
+     * @brief Get the compressed resource, compressing it on a miss.
+     * @param path The path of the resource relative to srcDir (as in the URL).
+     * @param file The open file of the resource.
+     * @param coding The content-coding, "gzip" or "deflate".
+     * @return The entry, or nullptr if the file is not to be compressed.
+     */
+    std::shared_ptr<const Entry> get(const std::string& path, const OpenFile& file, const std::string& coding);
+
+    /**
+     * @brief Compress the data, also used for dynamic content.
+     * @param coding The content-coding, "gzip" or "deflate".
+     * @param level The zlib compression level.
+     * @param out The compressed data.
+     * @return A flag whether it succeeds.
+     */
+    static bool compress(const char* data, size_t len, const std::string& coding, int level, std::string& out);
+
+    /**
+     * @brief Check whether the content-coding is supported.
+     */
+    static bool isSupported(const std::string& coding);
+
+    int level() const { return level_; }
+    size_t hitCount() const { return hits_; }
+    size_t missCount() const { return misses_; }
+
+private:
+    CompressCache();
+    ~CompressCache() = default;
+
+    /**
+     * @brief Remove an entry, the caller should hold the lock.
+     */
+    void erase_(const std::string& key);
+
+    static size_t entrySize_(const std::string& key, const Entry& entry);
+
+    struct Node {
+        std::shared_ptr<const Entry> entry;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    int level_;
+    size_t minSize_;
+    size_t maxSize_;
+    size_t capacity_;
+    size_t used_;
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+    std::list<std::string> lru_;        // Most recently used at the front
+    std::unordered_map<std::string, Node> entries_;
+    std::mutex mtx_;
+};
+
+#endif //COMPRESS_CACHE_H
@@ -0,0 +1,88 @@
+/*
+ * @file        : fdcache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "fdcache.h"
+
+std::shared_ptr<const OpenFile> OpenFile::open(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return nullptr;
+    struct stat st;
+    if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    return std::make_shared<const OpenFile>(fd, st);
+}
+
+FdCache* FdCache::Instance() {
+    static FdCache cache;
+    return &cache;
+}
+
+FdCache::FdCache() : capacity_(0), generation_(0) {}
+
+void FdCache::init(size_t capacity) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    capacity_ = capacity;
+    while(files_.size() > capacity_)
+        erase_(lru_.back());
+}
+
+std::shared_ptr<const OpenFile> FdCache::get(const std::string& path, const std::string& filename) {
+    unsigned long generation;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        auto it = files_.find(path);
+        if(it != files_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+            return it->second.file;
+        }
+        generation = generation_;
+    }
+
+    std::shared_ptr<const OpenFile> file = OpenFile::open(filename);
+    if(!file)
+        return nullptr;
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    // Don't insert if the file may have changed during opening.
+    if(capacity_ == 0 || generation != generation_)
+        return file;
+    auto it = files_.find(path);
+    if(it != files_.end())  // Opened concurrently, share the cached one.
+        return it->second.file;
+    while(files_.size() >= capacity_)
+        erase_(lru_.back());
+    lru_.push_front(path);
+    files_[path] = { file, lru_.begin() };
+    return file;
+}
+
+void FdCache::erase_(const std::string& path) {
+    auto it = files_.find(path);
+    if(it == files_.end())
+        return;
+    auto lruIt = it->second.lruIt;
+    files_.erase(it);
+    lru_.erase(lruIt);  // The path may refer to this node, so it goes last.
+}
+
+void FdCache::invalidate(const std::string& path, bool isDir) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    generation_++;
+    if(!isDir) {
+        erase_(path);
+        return;
+    }
+    std::string prefix = path + "/";
+    for(auto it = lru_.begin(); it != lru_.end(); ) {
+        const std::string& key = *it++;
+        if(key.compare(0, prefix.size(), prefix) == 0)
+            erase_(key);
+    }
+}
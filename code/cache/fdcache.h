@@ -0,0 +1,100 @@
+/*
+ * @file        : fdcache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the FdCache class, which is designed for 
+ *                sharing the open File Descriptors and stat metadata of static resources among 
+ *                connections, so that concurrent downloads of a file skip open and stat.
+ */
+
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+
+#include <fcntl.h>       // open
+#include <unistd.h>      // close
+#include <sys/stat.h>    // fstat
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../log/log.h"
+
+/**
+ * @struct OpenFile
+ * @brief An open regular file with its stat metadata.
+ * 
+ * The File Descriptor is closed when the last owner releases it. It is only used 
+ * with explicit offsets (sendfile, pread), so it can be shared by connections.
+ */
+struct OpenFile {
+    int fd;
+    struct stat st;
+
+    OpenFile(int fd_, const struct stat& st_) : fd(fd_), st(st_) {}
+    ~OpenFile() { close(fd); }
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+
+    /**
+     * @brief Open a regular file.
+     * @return The open file, or nullptr if it is absent or not a regular file.
+     */
+    static std::shared_ptr<const OpenFile> open(const std::string& filename);
+};
+
+/**
+ * @class FdCache
+ * @brief The FdCache class is used to cache open files of static resources.
+ * 
+ * Entries are reference counted: an evicted or invalidated file stays open 
+ * until the connections sending it are done. The number of cached files is 
+ * bounded and the least recently used one is evicted first.
+ */
+class FdCache {
+public:
+    static FdCache* Instance();
+
+    /**
+     * @brief Set the max number of cached files (0 to disable the cache).
+     */
+    void init(size_t capacity);
+
+    /**
+     * @brief Get the open file of the resource, opening it on a miss.
+     * @param path The path of the resource relative to srcDir (as in the URL).
+     * @param filename The path of the file in the file system.
+     * @return The open file, or nullptr if it is absent or not a regular file.
+     */
+    std::shared_ptr<const OpenFile> get(const std::string& path, const std::string& filename);
+
+    /**
+     * @brief Invalidate the cached files of the path.
+     * @param path The changed path relative to srcDir.
+     * @param isDir Whether to drop every file under the path.
+     */
+    void invalidate(const std::string& path, bool isDir);
+
+private:
+    FdCache();
+    ~FdCache() = default;
+
+    /**
+     * @brief Remove an entry, the caller should hold the lock.
+     */
+    void erase_(const std::string& path);
+
+    struct Node {
+        std::shared_ptr<const OpenFile> file;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    size_t capacity_;
+    unsigned long generation_;          // Bumped by every invalidation
+    std::list<std::string> lru_;        // Most recently used at the front
+    std::unordered_map<std::string, Node> files_;
+    std::mutex mtx_;
+};
+
+#endif //FD_CACHE_H
@@ -0,0 +1,119 @@
+/*
+ * @file        : mmapcache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "mmapcache.h"
+#include "../http/httpresponse.h"
+
+MmapCache* MmapCache::Instance() {
+    static MmapCache cache;
+    return &cache;
+}
+
+MmapCache::MmapCache() : minSize_(0), maxSize_(0), hotHits_(1), capacity_(0), used_(0) {}
+
+void MmapCache::init(size_t minSize, size_t maxSize, unsigned hotHits, size_t capacity) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    minSize_ = minSize;
+    maxSize_ = maxSize;
+    hotHits_ = hotHits;
+    capacity_ = capacity;
+    while(used_ > capacity_ && !lru_.empty())
+        erase_(lru_.back());
+}
+
+static bool sameFile(const struct stat& a, const struct stat& b) {
+    return a.st_ino == b.st_ino && a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec 
+        && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+std::shared_ptr<const MappedFile> MmapCache::get(const std::string& path, const OpenFile& file) {
+    size_t fileSize = file.st.st_size;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(capacity_ == 0 || fileSize < minSize_ || fileSize > maxSize_ || fileSize > capacity_)
+            return nullptr;
+        auto it = files_.find(path);
+        if(it != files_.end()) {
+            if(sameFile(it->second.file->st, file.st)) {
+                lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+                return it->second.file;
+            }
+            erase_(path);   // The file has changed, remap it.
+        }
+        else {
+            if(hits_.size() >= MAX_TRACKED && !hits_.count(path))
+                hits_.clear();
+            if(++hits_[path] < hotHits_)
+                return nullptr;
+        }
+        hits_.erase(path);
+    }
+
+    std::shared_ptr<MappedFile> mapped = map_(path, file);
+    if(!mapped)
+        return nullptr;
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = files_.find(path);
+    if(it != files_.end())  // Mapped concurrently, share the cached one.
+        return it->second.file;
+    while(used_ + mapped->len > capacity_ && !lru_.empty())
+        erase_(lru_.back());
+    lru_.push_front(path);
+    files_[path] = { mapped, lru_.begin() };
+    used_ += mapped->len;
+    return mapped;
+}
+
+std::shared_ptr<MappedFile> MmapCache::map_(const std::string& path, const OpenFile& file) {
+    std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>();
+    void* addr = mmap(nullptr, file.st.st_size, PROT_READ, MAP_SHARED, file.fd, 0);
+    if(addr == MAP_FAILED) {
+        LOG_WARN("MmapCache: mmap %s error: %s", path.c_str(), strerror(errno));
+        return nullptr;
+    }
+    // The whole file is about to be sent from the front to the end.
+    madvise(addr, file.st.st_size, MADV_WILLNEED);
+    madvise(addr, file.st.st_size, MADV_SEQUENTIAL);
+
+    mapped->data = static_cast<const char*>(addr);
+    mapped->len = file.st.st_size;
+    mapped->st = file.st;
+    mapped->etag = HttpResponse::makeETag(file.st);
+    mapped->lastModified = file.st.st_mtime;
+    mapped->header = "Content-Type: " + HttpResponse::fileType(path) + "\r\n";
+    mapped->header += "Content-Length: " + std::to_string(mapped->len) + "\r\n";
+    mapped->header += "ETag: " + mapped->etag + "\r\n";
+    mapped->header += "Last-Modified: " + HttpResponse::httpDate(mapped->lastModified) + "\r\n";
+    LOG_DEBUG("MmapCache: mapped %s (%zu bytes)", path.c_str(), mapped->len);
+    return mapped;
+}
+
+void MmapCache::erase_(const std::string& path) {
+    auto it = files_.find(path);
+    if(it == files_.end())
+        return;
+    auto lruIt = it->second.lruIt;
+    used_ -= it->second.file->len;
+    files_.erase(it);
+    lru_.erase(lruIt);  // The path may refer to this node, so it goes last.
+}
+
+void MmapCache::invalidate(const std::string& path, bool isDir) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(!isDir) {
+        erase_(path);
+        hits_.erase(path);
+        return;
+    }
+    std::string prefix = path + "/";
+    for(auto it = lru_.begin(); it != lru_.end(); ) {
+        const std::string& key = *it++;
+        if(key.compare(0, prefix.size(), prefix) == 0)
+            erase_(key);
+    }
+}
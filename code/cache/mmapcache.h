@@ -0,0 +1,113 @@
+/*
+ * @file        : mmapcache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the MmapCache class, which is designed for 
+ *                mapping frequently requested medium-sized files into memory once and sharing the 
+ *                mappings among connections, as an alternative to sendfile from an open file.
+ */
+
+#ifndef MMAP_CACHE_H
+#define MMAP_CACHE_H
+
+#include <sys/mman.h>    // mmap, madvise
+#include <sys/stat.h>
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "fdcache.h"
+#include "../log/log.h"
+
+/**
+ * @struct MappedFile
+ * @brief A read-only mapping of a whole file with its pre-rendered header fields.
+ * 
+ * The mapping is only read by the kernel (writev), so a file truncated under it 
+ * makes the write fail with EFAULT rather than raising SIGBUS.
+ */
+struct MappedFile {
+    const char* data;
+    size_t len;
+    std::string header;     // Pre-rendered entity header fields, each ends with CRLF
+    std::string etag;       // Validators of the content, also rendered in the header
+    time_t lastModified;
+    struct stat st;         // To detect a changed file
+
+    MappedFile() : data(nullptr), len(0), lastModified(0) {}
+    ~MappedFile() { if(data) munmap(const_cast<char*>(data), len); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+/**
+ * @class MmapCache
+ * @brief The MmapCache class is used to share mappings of hot files among connections.
+ * 
+ * A file is mapped once it has been requested hotHits times. The mappings are 
+ * reference counted, remapped when the file changes and evicted in LRU order 
+ * once the mapped bytes exceed the capacity.
+ */
+class MmapCache {
+public:
+    static MmapCache* Instance();
+
+    /**
+     * @brief Set the limits of the cache.
+     * @param minSize Files smaller than it are not mapped.
+     * @param maxSize Files larger than it are not mapped.
+     * @param hotHits The number of requests before a file is mapped.
+     * @param capacity The cap of all mapped bytes (0 to disable the cache).
+     */
+    void init(size_t minSize, size_t maxSize, unsigned hotHits, size_t capacity);
+
+    /**
+     * @brief Get the mapping of the resource if it is hot.
+     * @param path The path of the resource relative to srcDir (as in the URL).
+     * @param file The open file of the resource.
+     * @return The mapping, or nullptr if the file is not to be mapped (yet).
+     */
+    std::shared_ptr<const MappedFile> get(const std::string& path, const OpenFile& file);
+
+    /**
+     * @brief Invalidate the mappings of the path.
+     * @param path The changed path relative to srcDir.
+     * @param isDir Whether to drop every mapping under the path.
+     */
+    void invalidate(const std::string& path, bool isDir);
+
+private:
+    MmapCache();
+    ~MmapCache() = default;
+
+    /**
+     * @brief Map the file with the access pattern hints.
+     */
+    std::shared_ptr<MappedFile> map_(const std::string& path, const OpenFile& file);
+
+    /**
+     * @brief Remove a mapping, the caller should hold the lock.
+     */
+    void erase_(const std::string& path);
+
+    struct Node {
+        std::shared_ptr<const MappedFile> file;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    size_t minSize_;
+    size_t maxSize_;
+    unsigned hotHits_;
+    size_t capacity_;
+    size_t used_;
+    std::unordered_map<std::string, unsigned> hits_; // Requests of the files not mapped yet
+    std::list<std::string> lru_;        // Most recently used at the front
+    std::unordered_map<std::string, Node> files_;
+    std::mutex mtx_;
+
+    static const size_t MAX_TRACKED = 4096; // Max number of files counted in hits_
+};
+
+#endif //MMAP_CACHE_H
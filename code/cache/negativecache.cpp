@@ -0,0 +1,68 @@
+/*
+ * @file        : negativecache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "negativecache.h"
+
+NegativeCache* NegativeCache::Instance() {
+    static NegativeCache cache;
+    return &cache;
+}
+
+NegativeCache::NegativeCache() : capacity_(0), ttl_(0) {}
+
+void NegativeCache::init(size_t capacity, int ttlMS) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    capacity_ = capacity;
+    ttl_ = MS(ttlMS);
+    while(paths_.size() > capacity_)
+        erase_(order_.front());
+}
+
+bool NegativeCache::contains(const std::string& path) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = paths_.find(path);
+    if(it == paths_.end())
+        return false;
+    if(it->second.expireTime <= Clock::now()) {
+        erase_(path);
+        return false;
+    }
+    return true;
+}
+
+void NegativeCache::add(const std::string& path) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(capacity_ == 0)
+        return;
+    erase_(path);
+    while(paths_.size() >= capacity_)
+        erase_(order_.front());
+    order_.push_back(path);
+    paths_[path] = { Clock::now() + ttl_, std::prev(order_.end()) };
+}
+
+void NegativeCache::erase_(const std::string& path) {
+    auto it = paths_.find(path);
+    if(it == paths_.end())
+        return;
+    auto orderIt = it->second.orderIt;
+    paths_.erase(it);
+    order_.erase(orderIt);  // The path may refer to this node, so it goes last.
+}
+
+void NegativeCache::invalidate(const std::string& path, bool isDir) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    erase_(path);
+    if(!isDir)
+        return;
+    std::string prefix = path + "/";
+    for(auto it = order_.begin(); it != order_.end(); ) {
+        const std::string& key = *it++;
+        if(key.compare(0, prefix.size(), prefix) == 0)
+            erase_(key);
+    }
+}
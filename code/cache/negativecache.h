@@ -0,0 +1,76 @@
+/*
+ * @file        : negativecache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the NegativeCache class, which is designed 
+ *                for remembering recently missing resources, so that repeated requests for them 
+ *                are answered without touching the file system.
+ */
+
+#ifndef NEGATIVE_CACHE_H
+#define NEGATIVE_CACHE_H
+
+#include <string>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "../utils/timer/timer.h"
+
+/**
+ * @class NegativeCache
+ * @brief The NegativeCache class is used to cache the paths known to be missing.
+ * 
+ * Each path expires after a TTL, and is dropped earlier if the FileWatcher reports 
+ * a change of it. The number of paths is bounded and the oldest one is evicted first.
+ */
+class NegativeCache {
+public:
+    static NegativeCache* Instance();
+
+    /**
+     * @brief Set the limits of the cache.
+     * @param capacity The max number of paths (0 to disable the cache).
+     * @param ttlMS The time in milliseconds a path is remembered.
+     */
+    void init(size_t capacity, int ttlMS);
+
+    /**
+     * @brief Check whether the path is known to be missing.
+     */
+    bool contains(const std::string& path);
+
+    /**
+     * @brief Remember that the path is missing.
+     */
+    void add(const std::string& path);
+
+    /**
+     * @brief Forget the paths which may have been created.
+     * @param path The changed path relative to srcDir.
+     * @param isDir Whether to forget every path under it.
+     */
+    void invalidate(const std::string& path, bool isDir);
+
+private:
+    NegativeCache();
+    ~NegativeCache() = default;
+
+    /**
+     * @brief Remove a path, the caller should hold the lock.
+     */
+    void erase_(const std::string& path);
+
+    struct Node {
+        TimeStamp expireTime;
+        std::list<std::string>::iterator orderIt;
+    };
+
+    size_t capacity_;
+    MS ttl_;
+    std::list<std::string> order_;  // The oldest path at the front
+    std::unordered_map<std::string, Node> paths_;
+    std::mutex mtx_;
+};
+
+#endif //NEGATIVE_CACHE_H
@@ -0,0 +1,104 @@
+/*
+ * @file        : routecache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "routecache.h"
+
+RouteCache* RouteCache::Instance() {
+    static RouteCache cache;
+    return &cache;
+}
+
+RouteCache::RouteCache() : capacity_(0) {
+    for(Shard& shard: shards_)
+        shard.map = std::make_shared<Map>();
+}
+
+void RouteCache::init(size_t capacity) {
+    capacity_ = (capacity + SHARDS - 1) / SHARDS;
+    clear();
+}
+
+std::string RouteCache::key_(std::string_view method, std::string_view path) {
+    std::string key;
+    key.reserve(method.size() + 1 + path.size());
+    key.append(method).append(1, ' ').append(path);
+    return key;
+}
+
+bool RouteCache::isCanonical_(std::string_view path) {
+    if(path.empty() || path[0] != '/')
+        return false;
+    // Every segment after a '/' must be a name, not empty, "." or "..".
+    for(size_t begin = 1; begin <= path.size(); ) {
+        size_t end = std::min(path.find('/', begin), path.size());
+        std::string_view segment = path.substr(begin, end - begin);
+        if((segment.empty() && end < path.size()) || segment == "." || segment == "..")
+            return false;
+        begin = end + 1;
+    }
+    return true;
+}
+
+std::shared_ptr<const RouteCache::Entry> RouteCache::get(std::string_view method, std::string_view path) {
+    std::string key = key_(method, path);
+    std::shared_ptr<const Map> map = std::atomic_load(&shard_(key).map);
+    if(map->empty())
+        return nullptr;
+    auto it = map->find(key);
+    return it != map->end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const RouteCache::Entry> RouteCache::add(std::string_view method, std::string_view path, 
+                                                          Route::Handler handler) {
+    if(capacity_ == 0 || !isCanonical_(path))
+        return nullptr;
+    std::string key = key_(method, path);
+    Shard& shard = shard_(key);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    std::shared_ptr<const Entry> entry = std::make_shared<Entry>(handler, path);
+    std::shared_ptr<Map> map = std::make_shared<Map>(*shard.map);
+    if(!map->count(key)) {
+        while(!shard.order.empty() && map->size() >= capacity_) {
+            map->erase(shard.order.front());    // The oldest target, no recency is tracked on the read path
+            shard.order.pop_front();
+        }
+        shard.order.push_back(key);
+    }
+    (*map)[std::move(key)] = entry;
+    std::atomic_store(&shard.map, std::shared_ptr<const Map>(std::move(map)));
+    return entry;
+}
+
+void RouteCache::invalidate(const std::string& path, bool isDir) {
+    std::string prefix = path + "/";
+    for(Shard& shard: shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        std::shared_ptr<Map> map;
+        for(auto& item: *shard.map) {
+            const std::string& target = item.second->target;
+            if(target == path || (isDir && target.compare(0, prefix.size(), prefix) == 0)) {
+                if(!map)
+                    map = std::make_shared<Map>(*shard.map);
+                map->erase(item.first);
+            }
+        }
+        if(map) {
+            shard.order.erase(std::remove_if(shard.order.begin(), shard.order.end(),
+                                             [&map](const std::string& key) { return !map->count(key); }),
+                              shard.order.end());
+            std::atomic_store(&shard.map, std::shared_ptr<const Map>(std::move(map)));
+        }
+    }
+}
+
+void RouteCache::clear() {
+    for(Shard& shard: shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.order.clear();
+        std::atomic_store(&shard.map, std::shared_ptr<const Map>(std::make_shared<Map>()));
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * @file        : routecache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the RouteCache class, which is designed 
+ *                for remembering how request targets were resolved, so that repeated requests for 
+ *                the same resource skip the routing and the file system lookups.
+ */
+
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <deque>
+#include <algorithm>
+#include "../http/httpconn.h"
+
+/**
+ * @class RouteCache
+ * @brief The RouteCache class maps (method, path) to the resolved route and its target.
+ * 
+ * Readers look up an immutable snapshot of the map without taking the lock. Writers 
+ * copy the snapshot under the lock and publish the new one, which suits a map that 
+ * is read on every request and changes only when a new resource is first requested, 
+ * a file changes (reported by the FileWatcher) or the routes change. The targets are 
+ * spread over shards, so that a writer copies a small map, each one bounded and 
+ * evicting the oldest target. Only canonical paths are kept, so that the aliases of 
+ * a file (such as "//index.html" or "/./index.html") do not take an entry each.
+ */
+class RouteCache {
+public:
+    /**
+     * @struct Entry
+     * @brief A resolved route, whose argument views the target owned by the entry.
+     */
+    struct Entry {
+        Route route;
+        std::string target;     // Path of the resource relative to srcDir
+
+        Entry(Route::Handler handler, std::string_view path) : target(path) { route = { handler, target }; }
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+    };
+
+    static RouteCache* Instance();
+
+    /**
+     * @brief Set the limits of the cache.
+     * @param capacity The max number of resolved targets (0 to disable the cache).
+     */
+    void init(size_t capacity);
+
+    /**
+     * @brief Get the resolved route of the request target.
+     * @return The entry, nullptr if the target is not resolved yet.
+     */
+    std::shared_ptr<const Entry> get(std::string_view method, std::string_view path);
+
+    /**
+     * @brief Remember the resolved route of the request target.
+     * @param handler The handler, called with the path as the argument.
+     * @return The entry added, nullptr if the cache is disabled or the path is not canonical.
+     */
+    std::shared_ptr<const Entry> add(std::string_view method, std::string_view path, Route::Handler handler);
+
+    /**
+     * @brief Forget the targets of the path.
+     * @param path The changed path relative to srcDir.
+     * @param isDir Whether to forget every target under the path.
+     */
+    void invalidate(const std::string& path, bool isDir);
+
+    /**
+     * @brief Forget every target, such as when the routes change.
+     */
+    void clear();
+
+private:
+    RouteCache();
+    ~RouteCache() = default;
+
+    static std::string key_(std::string_view method, std::string_view path);
+
+    /**
+     * @brief Check whether the path has no empty, "." or ".." segment, which would alias another path.
+     */
+    static bool isCanonical_(std::string_view path);
+
+    using Map = std::unordered_map<std::string, std::shared_ptr<const Entry>>;
+
+    struct Shard {
+        std::shared_ptr<const Map> map; // The snapshot, loaded and replaced atomically
+        std::deque<std::string> order;  // The keys of the map, the oldest one at the front
+        std::mutex mtx;                 // Serializes the writers
+    };
+
+    Shard& shard_(const std::string& key) { return shards_[std::hash<std::string>()(key) % SHARDS]; }
+
+    static const size_t SHARDS = 16;
+
+    std::atomic<size_t> capacity_;      // Of each shard
+    Shard shards_[SHARDS];
+};
+
+#endif //ROUTE_CACHE_H
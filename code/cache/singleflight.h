@@ -0,0 +1,128 @@
+/*
+ * @file        : singleflight.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration and implementation of the SingleFlight class,
+ *                which is designed for sharing one call among the concurrent callers of the same key,
+ *                such as the lookups of a user or the loads of a file on a miss.
+ */
+
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+/**
+ * @class SingleFlight
+ * @brief The SingleFlight class is used to coalesce the concurrent calls of a key.
+ *
+ * The first caller of a key starts the call, the ones coming before it finishes join
+ * it and get its value, and the ones coming after start a new call. It does not keep
+ * the values, which is left to the caches in front of it. If the call throws, its
+ * callers get an empty value, Value(), and the key is free for the next call.
+ * @tparam Key The type of keys.
+ * @tparam Value The type of values, copied to each caller.
+ */
+template<class Key, class Value, class Hash = std::hash<Key>>
+class SingleFlight {
+public:
+    /**
+     * @brief Type definition for the callbacks of the callers.
+     */
+    using Callback = std::function<void(const Value&)>;
+
+    /**
+     * @brief Start the call of the key, or join the one in flight.
+     * @param done Called with the value, from the thread finishing the call.
+     * @param start Starts the call, called as start(finish), where finish(value) may be called from any thread.
+     * @return True if the call is started, false if joined.
+     */
+    template<class Start>
+    bool call(const Key& key, Callback done, Start start) {
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            auto it = calls_.find(key);
+            if(it != calls_.end()) {
+                it->second.push_back(std::move(done));
+                return false;
+            }
+            calls_[key].push_back(std::move(done));
+        }
+        // Finished once, by the call or by the exception thrown before it finishes.
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        try {
+            start([this, key, finished](const Value& value) {
+                if(!finished->exchange(true))
+                    finish_(key, value);
+            });
+        }
+        catch(...) {
+            if(!finished->exchange(true))
+                finish_(key, Value());
+            throw;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Run the work of the key in this thread, or wait for the one in flight (blocking).
+     * @param work Returns the value, called as work().
+     * @return The value.
+     */
+    template<class Work>
+    Value run(const Key& key, Work work) {
+        std::future<Value> joined;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            auto it = calls_.find(key);
+            if(it != calls_.end()) {
+                // Shared with the callback, which may still be setting it when this caller returns.
+                auto promise = std::make_shared<std::promise<Value>>();
+                joined = promise->get_future();
+                it->second.push_back([promise](const Value& value) { promise->set_value(value); });
+            }
+            else
+                calls_[key];
+        }
+        if(joined.valid())
+            return joined.get();
+        Value value;
+        try {
+            value = work();
+        }
+        catch(...) {
+            finish_(key, Value());
+            throw;
+        }
+        finish_(key, value);
+        return value;
+    }
+
+private:
+    /**
+     * @brief End the call and pass the value to its callers.
+     */
+    void finish_(const Key& key, const Value& value) {
+        std::vector<Callback> waiters;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            auto it = calls_.find(key);
+            waiters.swap(it->second);
+            calls_.erase(it);
+        }
+        for(auto& done: waiters)
+            done(value);
+    }
+
+    std::unordered_map<Key, std::vector<Callback>, Hash> calls_;   // The callers of the calls in flight
+    std::mutex mtx_;
+};
+
+#endif //SINGLE_FLIGHT_H
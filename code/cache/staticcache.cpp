@@ -0,0 +1,127 @@
+/*
+ * @file        : staticcache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "staticcache.h"
+#include "../http/httpresponse.h"
+
+StaticCache* StaticCache::Instance() {
+    static StaticCache cache;
+    return &cache;
+}
+
+StaticCache::StaticCache() : maxFileSize_(0), capacity_(0), used_(0), generation_(0) {}
+
+void StaticCache::init(size_t maxFileSize, size_t capacity) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    maxFileSize_ = maxFileSize;
+    capacity_ = capacity;
+    while(used_ > capacity_ && !lru_.empty())
+        erase_(lru_.back());
+}
+
+size_t StaticCache::entrySize_(const std::string& path, const Entry& entry) {
+    return path.size() + entry.header.size() + entry.body.size();
+}
+
+std::shared_ptr<const StaticCache::Entry> StaticCache::get(const std::string& path, const std::string& filename) {
+    unsigned long generation;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(maxFileSize_ == 0)
+            return nullptr;
+        auto it = entries_.find(path);
+        if(it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+            return it->second.entry;
+        }
+        generation = generation_;
+    }
+
+    // Load the file without holding the lock, the generation of a joined load is the one it started in.
+    Load load = loads_.run(path, [this, generation, &filename]() { return Load{ generation, load_(filename) }; });
+    std::shared_ptr<Entry>& entry = load.entry;
+    if(!entry)
+        return nullptr;
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    size_t size = entrySize_(path, *entry);
+    // Don't insert if the file may have changed during loading or it can never fit.
+    if(load.generation != generation_ || size > capacity_)
+        return entry;
+    if(entries_.count(path))
+        erase_(path);
+    while(used_ + size > capacity_ && !lru_.empty())
+        erase_(lru_.back());
+    lru_.push_front(path);
+    entries_[path] = { entry, lru_.begin() };
+    used_ += size;
+    return entry;
+}
+
+std::shared_ptr<StaticCache::Entry> StaticCache::load_(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return nullptr;
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) < 0 || !S_ISREG(fileStat.st_mode) || (size_t)fileStat.st_size > maxFileSize_) {
+        close(fd);
+        return nullptr;
+    }
+
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    entry->body.resize(fileStat.st_size);
+    size_t total = 0;
+    while(total < entry->body.size()) {
+        ssize_t len = read(fd, &entry->body[total], entry->body.size() - total);
+        if(len <= 0)
+            break;
+        total += len;
+    }
+    close(fd);
+    if(total != entry->body.size()) {
+        LOG_WARN("StaticCache: short read of %s", filename.c_str());
+        return nullptr;
+    }
+
+    entry->etag = HttpResponse::makeETag(fileStat);
+    entry->lastModified = fileStat.st_mtime;
+    entry->header = "Content-Type: " + HttpResponse::fileType(filename) + "\r\n";
+    entry->header += "Content-Length: " + std::to_string(entry->body.size()) + "\r\n";
+    entry->header += "ETag: " + entry->etag + "\r\n";
+    entry->header += "Last-Modified: " + HttpResponse::httpDate(entry->lastModified) + "\r\n";
+    return entry;
+}
+
+void StaticCache::erase_(const std::string& path) {
+    auto it = entries_.find(path);
+    if(it == entries_.end())
+        return;
+    auto lruIt = it->second.lruIt;
+    used_ -= entrySize_(path, *it->second.entry);
+    entries_.erase(it);
+    lru_.erase(lruIt);  // The path may refer to this node, so it goes last.
+}
+
+void StaticCache::invalidate(const std::string& path, bool isDir) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    generation_++;
+    if(!isDir) {
+        erase_(path);
+        return;
+    }
+    std::string prefix = path + "/";
+    for(auto it = lru_.begin(); it != lru_.end(); ) {
+        const std::string& key = *it++;
+        if(key.compare(0, prefix.size(), prefix) == 0)
+            erase_(key);
+    }
+}
+
+size_t StaticCache::size() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return used_;
+}
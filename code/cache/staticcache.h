@@ -0,0 +1,115 @@
+/*
+ * @file        : staticcache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the StaticCache class, which is designed 
+ *                for keeping small static resources in memory together with their pre-rendered 
+ *                response header fields, so that a hit is served without touching the file system.
+ */
+
+#ifndef STATIC_CACHE_H
+#define STATIC_CACHE_H
+
+#include <fcntl.h>       // open
+#include <unistd.h>      // close, read
+#include <sys/stat.h>    // fstat
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "singleflight.h"
+#include "../log/log.h"
+
+/**
+ * @class StaticCache
+ * @brief The StaticCache class is used to cache small static files in memory.
+ * 
+ * Each entry holds the content of the file and its entity header fields rendered 
+ * ahead of time. Entries are shared with the connections sending them, evicted in 
+ * LRU order once the memory cap is exceeded and invalidated by the FileWatcher.
+ */
+class StaticCache {
+public:
+    /**
+     * @struct Entry
+     * @brief A cached static resource.
+     */
+    struct Entry {
+        std::string header; // Pre-rendered entity header fields, each ends with CRLF
+        std::string body;   // Content of the file
+        std::string etag;   // Validators of the content, also rendered in the header
+        time_t lastModified;
+    };
+
+    static StaticCache* Instance();
+
+    /**
+     * @brief Set the limits of the cache.
+     * @param maxFileSize Files larger than it are never cached (0 to disable the cache).
+     * @param capacity The memory cap of all entries in bytes.
+     */
+    void init(size_t maxFileSize, size_t capacity);
+
+    /**
+     * @brief Get the entry of the resource, loading it on a miss.
+     * @param path The path of the resource relative to srcDir (as in the URL).
+     * @param filename The path of the file in the file system.
+     * @return The entry, or nullptr if the file is absent or not cacheable.
+     */
+    std::shared_ptr<const Entry> get(const std::string& path, const std::string& filename);
+
+    /**
+     * @brief Invalidate the cached entries of the path.
+     * @param path The changed path relative to srcDir.
+     * @param isDir Whether to drop every entry under the path.
+     */
+    void invalidate(const std::string& path, bool isDir);
+
+    /**
+     * @brief Get the memory used by the entries in bytes.
+     */
+    size_t size();
+
+private:
+    StaticCache();
+    ~StaticCache() = default;
+
+    /**
+     * @brief Read the file and render its header fields.
+     * @return The new entry, or nullptr if the file is not cacheable.
+     */
+    std::shared_ptr<Entry> load_(const std::string& filename);
+
+    /**
+     * @brief Remove an entry, the caller should hold the lock.
+     */
+    void erase_(const std::string& path);
+
+    static size_t entrySize_(const std::string& path, const Entry& entry);
+
+    /**
+     * @brief A loaded entry with the generation it was loaded in.
+     */
+    struct Load {
+        unsigned long generation;
+        std::shared_ptr<Entry> entry;
+    };
+
+    struct Node {
+        std::shared_ptr<const Entry> entry;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    size_t maxFileSize_;
+    size_t capacity_;
+    size_t used_;
+    unsigned long generation_;          // Bumped by every invalidation
+    std::list<std::string> lru_;        // Most recently used at the front
+    std::unordered_map<std::string, Node> entries_;
+    std::mutex mtx_;
+    SingleFlight<std::string, Load> loads_;    // The concurrent misses of a path read the file once
+};
+
+#endif //STATIC_CACHE_H
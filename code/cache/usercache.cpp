@@ -0,0 +1,91 @@
+/*
+ * @file        : usercache.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "usercache.h"
+
+UserCache* UserCache::Instance() {
+    static UserCache cache;
+    return &cache;
+}
+
+UserCache::UserCache() : capacity_(0), ttlMS_(0), negativeTtlMS_(0), hits_(0), misses_(0) {}
+
+void UserCache::init(size_t capacity, int ttlMS, int negativeTtlMS) {
+    capacity_ = (capacity + SHARDS - 1) / SHARDS;
+    ttlMS_ = ttlMS;
+    negativeTtlMS_ = negativeTtlMS;
+    for(Shard& shard: shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        while(shard.users.size() > capacity_)
+            erase_(shard, shard.order.front());
+    }
+}
+
+bool UserCache::get(const std::string& name, User& user) {
+    Shard& shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.users.find(name);
+    if(it == shard.users.end() || it->second.expireTime <= Clock::now()) {
+        if(it != shard.users.end())
+            erase_(shard, name);
+        misses_++;
+        return false;
+    }
+    user = it->second.user;
+    hits_++;
+    return true;
+}
+
+void UserCache::add(const std::string& name, const User& user) {
+    Shard& shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.generation++;
+    insert_(shard, name, user);
+}
+
+unsigned long UserCache::generation(const std::string& name) {
+    Shard& shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    return shard.generation;
+}
+
+bool UserCache::fill(const std::string& name, const User& user, unsigned long generation) {
+    Shard& shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    // The user may have been changed after the lookup read it, keep the change instead.
+    if(generation != shard.generation || capacity_ == 0)
+        return false;
+    insert_(shard, name, user);
+    return true;
+}
+
+void UserCache::insert_(Shard& shard, const std::string& name, const User& user) {
+    if(capacity_ == 0)
+        return;
+    erase_(shard, name);
+    while(shard.users.size() >= capacity_)
+        erase_(shard, shard.order.front());
+    shard.order.push_back(name);
+    shard.users[name] = { user, Clock::now() + MS(user.exists ? ttlMS_.load() : negativeTtlMS_.load()),
+                          std::prev(shard.order.end()) };
+}
+
+void UserCache::erase(const std::string& name) {
+    Shard& shard = shard_(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.generation++;
+    erase_(shard, name);
+}
+
+void UserCache::erase_(Shard& shard, const std::string& name) {
+    auto it = shard.users.find(name);
+    if(it == shard.users.end())
+        return;
+    auto orderIt = it->second.orderIt;
+    shard.users.erase(it);
+    shard.order.erase(orderIt);  // The name may refer to this node, so it goes last.
+}
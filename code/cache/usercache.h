@@ -0,0 +1,129 @@
+/*
+ * @file        : usercache.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the UserCache class, which is designed
+ *                for remembering recent lookups of users in the database, so that repeated logins
+ *                of the same accounts, and of unknown ones, are answered without a round trip.
+ */
+
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <string>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "../utils/timer/timer.h"
+
+/**
+ * @class UserCache
+ * @brief The UserCache class is used to cache the passwords of users by name.
+ *
+ * A user known to be missing is cached too, for a shorter TTL. The names are spread
+ * over shards with their own locks, each one bounded and evicting the oldest name
+ * first. A change of a user in the database shows after the TTL at most, unless it
+ * is made through the server, which updates the cache.
+ *
+ * A lookup may finish after a change made meanwhile, so its result is cached with
+ * fill, only if the shard of the name is not written since the generation taken
+ * before the lookup started.
+ */
+class UserCache {
+public:
+    /**
+     * @brief The user as found in the database.
+     */
+    struct User {
+        bool exists = false;
+        std::string password;
+    };
+
+    static UserCache* Instance();
+
+    /**
+     * @brief Set the limits of the cache.
+     * @param capacity The max number of users (0 to disable the cache).
+     * @param ttlMS The time in milliseconds a user is remembered.
+     * @param negativeTtlMS The time in milliseconds a missing user is remembered.
+     */
+    void init(size_t capacity, int ttlMS, int negativeTtlMS);
+
+    /**
+     * @brief Get the cached user.
+     * @param name The name of the user.
+     * @param user Set to the user on a hit.
+     * @return True on a hit.
+     */
+    bool get(const std::string& name, User& user);
+
+    /**
+     * @brief Remember the user as changed through the server, replacing the user cached.
+     */
+    void add(const std::string& name, const User& user);
+
+    /**
+     * @brief Get the generation of the shard of the name, to be taken before looking it up.
+     */
+    unsigned long generation(const std::string& name);
+
+    /**
+     * @brief Remember the user found (or not) in the database, unless the shard of the
+     * name is written after the lookup started.
+     * @param generation The generation taken before the lookup.
+     * @return True if the user is cached.
+     */
+    bool fill(const std::string& name, const User& user, unsigned long generation);
+
+    /**
+     * @brief Forget the user, whose state in the database is unknown.
+     */
+    void erase(const std::string& name);
+
+    size_t hitCount() const { return hits_; }
+    size_t missCount() const { return misses_; }
+
+private:
+    UserCache();
+    ~UserCache() = default;
+
+    struct Node {
+        User user;
+        TimeStamp expireTime;
+        std::list<std::string>::iterator orderIt;
+    };
+
+    struct Shard {
+        std::list<std::string> order;   // The oldest name at the front
+        std::unordered_map<std::string, Node> users;
+        unsigned long generation = 0;   // Bumped by every add and erase
+        std::mutex mtx;
+    };
+
+    Shard& shard_(const std::string& name) { return shards_[std::hash<std::string>()(name) % SHARDS]; }
+
+    /**
+     * @brief Remove a user, the caller should hold the lock of the shard.
+     */
+    static void erase_(Shard& shard, const std::string& name);
+
+    /**
+     * @brief Insert the user as the newest one, the caller should hold the lock of the shard.
+     */
+    void insert_(Shard& shard, const std::string& name, const User& user);
+
+    static const size_t SHARDS = 16;
+
+    std::atomic<size_t> capacity_;  // Of each shard
+    std::atomic<int> ttlMS_;
+    std::atomic<int> negativeTtlMS_;
+    Shard shards_[SHARDS];
+
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+};
+
+#endif //USER_CACHE_H
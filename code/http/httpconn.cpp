@@ -9,11 +9,23 @@
 #include "router.h"
 
 bool HttpConn::isET;
+size_t HttpConn::writeQuota = 1024 * 1024;
+int HttpConn::writeTimeQuotaUS = 5000;
+size_t HttpConn::bandwidthCap = 0;
+std::function<void(int, uint64_t, HttpConn::Completion)> HttpConn::resumeHook;
 Router HttpConn::router;
+std::atomic<uint64_t> HttpConn::idSeq_(0);
+
+const size_t HttpConn::MIN_BURST;
 
 HttpConn::HttpConn() { 
     socketFd_ = -1;
     addr_ = { 0 };
+    id_ = 0;
+    suspended_ = false;
+    suspendCount_ = 0;
+    tokens_ = 0;
+    bucketTime_ = Clock::now();
 };
 
 HttpConn::~HttpConn() { 
@@ -25,8 +37,12 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
     assert(fd > 0);
     socketFd_ = fd;
     addr_ = addr;
+    id_ = ++idSeq_;
+    suspended_ = false;
     readBuff_.delData(readBuff_.size());
     writeBuff_.delData(writeBuff_.size());
+    tokens_ = bandwidthCap;
+    bucketTime_ = Clock::now();
     LOG_INFO("Client[%d](%s:%d) in", socketFd_, getIP(), getPort());
 }
 
@@ -46,8 +62,14 @@ int HttpConn::getPort() const {
     return addr_.sin_port;
 }
 
+uint64_t HttpConn::getId() const {
+    return id_;
+}
+
 off64_t HttpConn::toWriteBytes() const {
-    return writeBuff_.size() + response_.contentLen() - response_.contentOffset();
+    // The length of a streamed body is unknown, count at least one byte until it finishes.
+    return writeBuff_.size() + response_.contentLen() - response_.contentOffset() + response_.pendingLen() 
+         + (response_.streaming() ? 1 : 0);
 }
 
 off64_t HttpConn::readSocket(int* saveErrno) {
@@ -61,32 +83,104 @@ off64_t HttpConn::readSocket(int* saveErrno) {
     return len;
 }
 
-bool HttpConn::process() {
+HttpConn::PROCESS_STATE HttpConn::process() {
     if(!readBuff_.size()) {
         LOG_DEBUG("No Data in Buffer");
-        return false;
+        return WAIT_READ;
     }
     if(!request_.parse(readBuff_)){
         LOG_DEBUG("Header not Ready");
-        return false;        
+        return WAIT_READ;
     }
     if (!cachedHandler) {  // 如果没有缓存的处理函数
         // LOG_DEBUG("Getting Handler");
         cachedHandler = router.getHandler(*this);
     } 
+    unsigned suspends = suspendCount_;
     if(!cachedHandler(*this))   // 如果处理函数还需要等待数据
-        return false;
+        // The connection may be resumed by now, so tell the states apart by the count.
+        return suspendCount_ != suspends ? SUSPENDED : WAIT_READ;
     // 处理函数执行完毕，回收并重置request类解析结果
-    cachedHandler = nullptr;
+    cachedHandler = Route();
+    cachedTarget.reset();
     request_.clear();
-    return true;
+    return WAIT_WRITE;
+}
+
+HttpConn::Resumer HttpConn::suspend() {
+    assert(resumeHook);
+    suspended_ = true;
+    suspendCount_++;
+    int fd = socketFd_;
+    uint64_t id = id_;
+    return [fd, id](Completion completion) { resumeHook(fd, id, std::move(completion)); };
+}
+
+void HttpConn::resume(const Completion& completion) {
+    completion(*this);
+    cachedHandler = Route();
+    cachedTarget.reset();
+    request_.clear();
+    suspended_ = false;
+}
+
+int HttpConn::throttleMS() const {
+    if(bandwidthCap == 0 || tokens_ >= (double)std::min(MIN_BURST, (size_t)toWriteBytes()))
+        return 0;
+    // Wait until the bucket refills enough for the next write.
+    double needed = std::min(MIN_BURST, (size_t)toWriteBytes()) - tokens_;
+    return std::max(1, (int)(needed * 1000 / bandwidthCap));
+}
+
+size_t HttpConn::writeBudget_() {
+    if(bandwidthCap == 0)
+        return writeQuota;
+    // Refill the token bucket, which holds at most one second of bandwidth.
+    TimeStamp now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - bucketTime_).count();
+    tokens_ = std::min((double)bandwidthCap, tokens_ + elapsed * bandwidthCap);
+    bucketTime_ = now;
+    return tokens_ > 0 ? std::min(writeQuota, (size_t)tokens_) : 0;
 }
 
 ssize_t HttpConn::writeSocket(int* saveErrno) {
     ssize_t totalLen = 0;
+    size_t budget = writeBudget_();
+    TimeStamp deadline = Clock::now() + std::chrono::microseconds(writeTimeQuotaUS);
+    if(budget == 0 || throttleMS() > 0) {
+        *saveErrno = EAGAIN;
+        return 0;
+    }
     do {
-        if(writeBuff_.size()){
-            ssize_t len = write(socketFd_, writeBuff_.data(), writeBuff_.size());
+        if(response_.contentOffset() == response_.contentLen()) {
+            response_.nextPart(writeBuff_); // Move to the next part of a multipart response (if any)
+            // Produce the next chunk only after the previous one is written, so a slow 
+            // client holds back the producer instead of growing the buffer.
+            if(!writeBuff_.size() && !response_.nextChunk(writeBuff_))
+                break;
+        }
+        size_t quota = budget - totalLen;
+        if(response_.contentFd() < 0){
+            // The content (if any) is in memory, send it along with the header.
+            struct iovec iov[2];
+            iov[0].iov_base = const_cast<char*>(writeBuff_.data());
+            iov[0].iov_len = std::min(writeBuff_.size(), quota);
+            iov[1].iov_base = const_cast<char*>(response_.contentData() + response_.contentOffset());
+            iov[1].iov_len = std::min((size_t)(response_.contentLen() - response_.contentOffset()), quota - iov[0].iov_len);
+            ssize_t len = writev(socketFd_, iov, 2);
+            if(len <= 0) {
+                *saveErrno = errno;
+                break;
+            }
+            size_t headerLen = std::min((size_t)len, iov[0].iov_len);
+            writeBuff_.delData(headerLen);
+            response_.contentSend(len - headerLen);
+            totalLen += len;
+        }
+        else if(writeBuff_.size()){
+            // Hold the header back with MSG_MORE if sendfile follows, so they share segments.
+            int flags = response_.contentLen() > response_.contentOffset() ? MSG_MORE : 0;
+            ssize_t len = send(socketFd_, writeBuff_.data(), std::min(writeBuff_.size(), quota), flags);
             if(len <= 0) {
                 *saveErrno = errno;
                 break;
@@ -97,11 +191,11 @@ ssize_t HttpConn::writeSocket(int* saveErrno) {
         else{   
             off64_t offset = response_.contentOffset();
 
-            size_t count = SSIZE_MAX;
+            size_t count = quota;
 
             // if(response_.contentLen() < response_.contentOffset() + SSIZE_MAX)
             // if(response_.contentLen() - response_.contentOffset() < count)
-            if(response_.contentLen() - response_.contentOffset() < SSIZE_MAX)
+            if(response_.contentLen() - response_.contentOffset() < (off64_t)count)
                 count = response_.contentLen() - response_.contentOffset();
 
             ssize_t len = sendfile(socketFd_, response_.contentFd(), &offset, count);
@@ -113,6 +207,10 @@ ssize_t HttpConn::writeSocket(int* saveErrno) {
             response_.contentSend(len);
             totalLen += len;
         }
-    } while(isET || toWriteBytes() > 10240);
+        // Yield to other connections once the quota of this turn is used up.
+    } while((size_t)totalLen < budget && Clock::now() < deadline && 
+            ((isET && toWriteBytes() > 0) || toWriteBytes() > 10240));
+    if(bandwidthCap)
+        tokens_ -= totalLen;
     return totalLen;
 }
\ No newline at end of file
@@ -17,18 +17,38 @@
 #include <limits.h>
 #include <sys/uio.h>     // readv
 #include <sys/sendfile.h>// sendfile
+#include <sys/socket.h>  // send
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>      
 #include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <functional>
 #include "httprequest.h"
 #include "httpresponse.h"
 #include "../pool/sqlconnRAII.h"
 #include "../utils/buffer/buffer.h"
+#include "../utils/timer/timer.h"
 #include "../log/log.h"
 
 
 class Router; // forward declaration
+class HttpConn;
+
+/**
+ * @struct Route
+ * @brief A handler of requests with its argument, such as the page it responds with.
+ */
+struct Route {
+    using Handler = bool (*)(HttpConn& connection, std::string_view arg);
+
+    Handler handler = nullptr;
+    std::string_view arg;
+
+    explicit operator bool() const { return handler != nullptr; }
+    bool operator()(HttpConn& connection) const { return handler(connection, arg); }
+};
 
 /**
  * @class HttpConn
@@ -93,31 +113,92 @@ public:
      */
     off64_t readSocket(int * saveErrno);
 
+    enum PROCESS_STATE {
+        WAIT_READ,      // The request is not complete yet
+        WAIT_WRITE,     // The response is ready to be written
+        SUSPENDED,      // The handler is waiting for an asynchronous result
+    };
+
     /**
      * @brief  To respond to the request.
      */
-    bool process();
+    PROCESS_STATE process();
+
+    /**
+     * @brief The completion of a suspended request, which makes the response.
+     */
+    using Completion = std::function<void(HttpConn&)>;
+
+    /**
+     * @brief Resumes a suspended request with its completion, called once from any thread.
+     */
+    using Resumer = std::function<void(Completion)>;
+
+    /**
+     * @brief Suspend the request, for the handler to wait for an asynchronous result.
+     * The handler returns false after calling it and the worker moves on to other connections.
+     * @return The resumer, which hands the completion to the server through resumeHook.
+     */
+    Resumer suspend();
+
+    /**
+     * @brief Make the response of the suspended request and finish the request.
+     */
+    void resume(const Completion& completion);
+
+    bool isSuspended() const {
+        return suspended_;
+    }
+
+    /**
+     * @brief  To get the id of the connection, unique among all the connections accepted.
+     */
+    uint64_t getId() const;
 
     /**
      * @brief  To write into the socket.
      */
     off64_t writeSocket(int *saveErrno);
 
+    /**
+     * @brief  To get the time in milliseconds to wait for the bandwidth cap, 0 if not throttled.
+     */
+    int throttleMS() const;
+
     static bool isET;
+    static size_t writeQuota;       // Max bytes written in one turn, to yield to other connections
+    static int writeTimeQuotaUS;    // Max time in microseconds spent writing in one turn
+    static size_t bandwidthCap;     // Max bytes per second of a connection (0 for unlimited)
+    static std::function<void(int fd, uint64_t id, Completion completion)> resumeHook; // Set by the server
 
 private:
     int socketFd_;
     struct  sockaddr_in addr_;
     bool isKeepAlive_;
+    uint64_t id_;
+    std::atomic<bool> suspended_;
+    unsigned suspendCount_;     // To tell a suspended handler from one waiting for data
 
     Buffer readBuff_;
     Buffer writeBuff_;
 
     HttpRequest request_;
     HttpResponse response_;
-    std::function<bool(HttpConn&)> cachedHandler; 
+    Route cachedHandler; 
+    std::shared_ptr<const void> cachedTarget;   // Keeps the argument of cachedHandler alive (if shared)
+
+    double tokens_;         // Token bucket of the bandwidth cap
+    TimeStamp bucketTime_;
+
+    /**
+     * @brief  To refill the token bucket and get the bytes allowed in this turn.
+     */
+    size_t writeBudget_();
+
+    static const size_t MIN_BURST = 16 * 1024; // Min bytes to wait for when throttled
 
     static Router router;
+    static std::atomic<uint64_t> idSeq_;
 };
 
 #endif //HTTP_CONN_H
\ No newline at end of file
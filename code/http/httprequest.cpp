@@ -11,6 +11,7 @@ void HttpRequest::clear() {
     method_ = url_ = version_ = "";
     state_ = REQUEST_LINE;
     header_.clear();
+    params_.clear();
 }
 
 bool HttpRequest::parse(Buffer& buff) {
@@ -95,6 +96,18 @@ std::string HttpRequest::url() const{
     return url_;
 }
 
+std::string_view HttpRequest::path() const{
+    std::string_view url(url_);
+    return url.substr(0, std::min(url.find('?'), url.size()));
+}
+
+std::string_view HttpRequest::param(std::string_view name) const{
+    for(auto& param: params_)
+        if(param.first == name)
+            return param.second;
+    return {};
+}
+
 std::string HttpRequest::version() const
 {
     return version_;
@@ -112,6 +125,24 @@ std::string HttpRequest::getPost(std::string key) const{
     return "";
 };
 
+double HttpRequest::encodingQuality(const std::string& coding) const{
+    auto it = header_.find("Accept-Encoding");
+    if(it == header_.end())
+        return 0;
+    // Such as "gzip, deflate;q=0.5, br;q=1.0, *;q=0"
+    static const std::regex pattern(" *([^ ;,]+) *(; *q=([0-9.]+))? *(,|$)");
+    double wildcard = 0;
+    for(std::sregex_iterator match(it->second.begin(), it->second.end(), pattern), end; match != end; ++match) {
+        std::string name = (*match)[1];
+        double quality = (*match)[3].matched ? atof((*match)[3].str().c_str()) : 1;
+        if(strcasecmp(name.c_str(), coding.c_str()) == 0)
+            return quality;
+        if(name == "*")
+            wildcard = quality;
+    }
+    return wildcard;
+}
+
 void HttpRequest::parseRequestLine_(const std::string& line) {
     // LOG_DEBUG("Parsing Request Line:%s", line.c_str());
     std::regex pattern("^([^ ]+) ([^ ]+) HTTP/([^ \r]+)\r\n$");
@@ -16,8 +16,11 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <regex>
 #include <errno.h>
+#include <strings.h>     // strcasecmp
 #include "../utils/buffer/buffer.h"
 #include "../log/log.h"
 
@@ -31,7 +34,11 @@
  * in the Buffer.
  */
 class HttpRequest {
+    friend class Router;
 public:
+    // Parameters captured from the path by the route, as (name, value) views.
+    using Params = std::vector<std::pair<std::string_view, std::string_view>>;
+
     enum PARSE_STATE {
         REQUEST_LINE,
         HEADERS,
@@ -81,6 +88,17 @@ public:
      */
     std::string url() const;
 
+    /**
+     * @brief Get the path of the URL, without the query (valid until the request is cleared).
+     */
+    std::string_view path() const;
+
+    /**
+     * @brief Get the value of the parameter captured by the route, such as "id" in "/user/:id".
+     * @return The view of the value in the URL (empty if no such parameter).
+     */
+    std::string_view param(std::string_view name) const;
+
     /**
      * @brief Get the http version of request.
      */
@@ -98,12 +116,20 @@ public:
      */
     std::string getPost(std::string key) const;
 
+    /**
+     * @brief Get the quality value of the content-coding in Accept-Encoding.
+     * @param coding The content-coding, such as "gzip" or "br".
+     * @return The quality value (0 if the coding is not acceptable).
+     */
+    double encodingQuality(const std::string& coding) const;
+
 private:
     PARSE_STATE state_;
     std::string method_, url_, version_; // Content of request line
     size_t contentExpect;
     std::unordered_map<std::string, std::string> header_; // Fields of request header
     std::unordered_map<std::string, std::string> post_; // Content of post request
+    Params params_;     // Parameters captured by the route
     const std::string CRLF = "\r\n"; // Suffix of Carriage Return Line Feed
     static const std::unordered_set<std::string> DEFAULT_HTML;
     
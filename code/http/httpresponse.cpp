@@ -5,9 +5,12 @@
  * @copyleft    : Apache 2.0
  */
 
+#include <climits>      // LLONG_MAX
+#include <stdlib.h>     // strtoll
 #include "httpresponse.h"
 
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
+// Tables built at compile time, each lookup probes one slot.
+static constexpr auto SUFFIX_TYPE = makePerfectHash<std::string_view, std::string_view>({
     { ".html",  "text/html" },
     { ".xml",   "text/xml" },
     { ".xhtml", "application/xhtml+xml" },
@@ -25,25 +28,37 @@ const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
     { ".avi",   "video/x-msvideo" },
     { ".gz",    "application/x-gzip" },
     { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
-};
+    { ".css",   "text/css" },
+    { ".js",    "text/javascript" },
+});
 
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
-    { 200, "OK" },
-    { 400, "Bad Request" },
-    { 403, "Forbidden" },
-    { 404, "Not Found" },
-};
+static constexpr auto STATUS_LINE = makePerfectHash<int, std::string_view>({
+    { 200, "HTTP/1.1 200 OK\r\n" },
+    { 206, "HTTP/1.1 206 Partial Content\r\n" },
+    { 304, "HTTP/1.1 304 Not Modified\r\n" },
+    { 400, "HTTP/1.1 400 Bad Request\r\n" },
+    { 403, "HTTP/1.1 403 Forbidden\r\n" },
+    { 404, "HTTP/1.1 404 Not Found\r\n" },
+    { 416, "HTTP/1.1 416 Range Not Satisfiable\r\n" },
+});
+
+std::atomic<unsigned long> HttpResponse::boundarySeq_(0);
 
 void HttpResponse::clear() {
     code_ = -1;
     header_.clear();
-    if(contentFd_ > 0)
-        close(contentFd_);
     contentComplete_ = false;
-    contentFd_ = -1;
+    contentFile_.reset();
     contentLen_ = contentOffset_ = 0;
+    contentData_.reset();
+    contentHeader_.reset();
+    etag_.clear();
+    lastModified_ = 0;
+    parts_.clear();
+    pendingLen_ = 0;
+    producer_ = nullptr;
+    chunked_ = false;
+    chunk_.delData(chunk_.size());
 }
 
 void HttpResponse::addHeader(const std::string &key, const std::string &value){
@@ -61,61 +76,325 @@ void HttpResponse::addHeader(const std::string &key, const std::string &value){
 // }
 
 bool HttpResponse::addBody(std::string &filepath){
-    if(contentComplete_){
-        LOG_DEBUG("Multiple Content");
+    std::shared_ptr<const OpenFile> file = OpenFile::open(filepath);
+    if (!file) {
+        LOG_DEBUG("Invalid Filepath");
         return false;
     }
-    contentFd_ = open(filepath.data(), O_RDONLY);
-    // std::cout<<contentFd_<<std::endl;
-    if (contentFd_ == -1) {
-        LOG_DEBUG("Invalid Filepath");
+    return addBody(std::move(file), filepath);
+}
+
+bool HttpResponse::addBody(std::shared_ptr<const OpenFile> file, const std::string& filepath){
+    if(contentComplete_){
+        LOG_DEBUG("Multiple Content");
         return false;
     }
-    struct stat file_stat;
-    if (fstat(contentFd_, &file_stat) == -1) {
-        LOG_DEBUG("Error Filelength");
+    contentFile_ = std::move(file);
+    contentLen_ = contentFile_->st.st_size;
+    contentComplete_ = true;
+    setValidators(makeETag(contentFile_->st), contentFile_->st.st_mtime);
+
+    addHeader("Content-Type", fileType(filepath));
+    addHeader("Content-Length", std::to_string(contentLen_));
+    return true;
+}
+
+bool HttpResponse::addBody(std::shared_ptr<const char> data, off64_t len, std::shared_ptr<const std::string> header){
+    if(contentComplete_){
+        LOG_DEBUG("Multiple Content");
         return false;
     }
-    contentLen_ = file_stat.st_size;
-    // std::cout<<contentLen_<<std::endl;
+    contentData_ = std::move(data);
+    contentHeader_ = std::move(header);
+    contentLen_ = len;
     contentComplete_ = true;
+    return true;
+}
 
-    std::string typeName = "text/plain";
+std::string HttpResponse::fileType(const std::string& filepath){
     std::string::size_type idx = filepath.find_last_of('.');
     if(idx != std::string::npos) {
-        std::string suffix = filepath.substr(idx);
-        if(SUFFIX_TYPE.count(suffix) == 1) {
-            typeName = SUFFIX_TYPE.find(suffix)->second;
+        const std::string_view* type = SUFFIX_TYPE.find(std::string_view(filepath).substr(idx));
+        if(type)
+            return std::string(*type);
+    }
+    return "text/plain";
+}
+
+bool HttpResponse::isCompressible(const std::string& filepath){
+    std::string type = fileType(filepath);
+    return type.compare(0, 5, "text/") == 0 || type.find("xml") != std::string::npos;
+}
+
+std::string HttpResponse::makeETag(const struct stat& st, const std::string& coding){
+    char etag[96];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx-%lx%09lx%s%s\"", (unsigned long)st.st_ino, (unsigned long)st.st_size, 
+             (unsigned long)st.st_mtim.tv_sec, (unsigned long)st.st_mtim.tv_nsec, coding.empty() ? "" : "-", coding.c_str());
+    return etag;
+}
+
+const std::string& HttpResponse::dateField_(){
+    thread_local time_t second = 0;
+    thread_local std::string field;
+    time_t now = time(nullptr);
+    if(now != second) {
+        second = now;
+        field = "Date: " + httpDate(now) + "\r\n";
+    }
+    return field;
+}
+
+std::string HttpResponse::httpDate(time_t t){
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char date[32];
+    size_t len = strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(date, len);
+}
+
+void HttpResponse::setValidators(const std::string& etag, time_t lastModified){
+    etag_ = etag;
+    lastModified_ = lastModified;
+}
+
+// Whether the list of entity tags of If-None-Match has the tag, compared weakly. The tags are
+// scanned as quoted strings, which may hold commas and '*' themselves.
+static bool matchETag(const std::string& list, const std::string& etag) {
+    size_t begin = list.find_first_not_of(" \t");
+    size_t end = list.find_last_not_of(" \t");
+    if(begin == std::string::npos)
+        return false;
+    if(list.compare(begin, end + 1 - begin, "*") == 0)
+        return true;
+    size_t pos = begin;
+    while(pos <= end) {
+        if(list[pos] == ' ' || list[pos] == '\t' || list[pos] == ',') {
+            pos++;
+            continue;
         }
+        if(list.compare(pos, 2, "W/") == 0)
+            pos += 2;
+        if(pos > end || list[pos] != '"')
+            return false;   // Malformed, matches nothing
+        size_t close = list.find('"', pos + 1);
+        if(close == std::string::npos)
+            return false;
+        if(list.compare(pos, close + 1 - pos, etag) == 0)
+            return true;
+        pos = close + 1;
     }
-    addHeader("Content-Type", typeName);
-    addHeader("Content-Length", std::to_string(contentLen_));
+    return false;
+}
+
+bool HttpResponse::checkNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince){
+    if(etag_.empty())
+        return false;
+    bool notModified = false;
+    if(!ifNoneMatch.empty())    // If-None-Match takes precedence: "*" or a list of (W/)"etag"
+        notModified = matchETag(ifNoneMatch, etag_);
+    else if(!ifModifiedSince.empty()) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        if(strptime(ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm))
+            notModified = lastModified_ <= timegm(&tm);
+    }
+    if(!notModified)
+        return false;
+
+    // A 304 response carries the validators but neither the body nor its entity headers.
+    dropBody_();
     return true;
 }
 
+void HttpResponse::dropBody_(){
+    contentFile_.reset();
+    contentData_.reset();
+    contentHeader_.reset();
+    contentLen_ = contentOffset_ = 0;
+    parts_.clear();
+    pendingLen_ = 0;
+    header_.erase("Content-Type");
+    header_.erase("Content-Length");
+    header_.erase("Content-Encoding");
+}
+
+bool HttpResponse::checkIfRange(const std::string& ifRange) const{
+    if(ifRange.empty())
+        return true;
+    if(ifRange[0] == '"')   // Strong comparison of entity tags
+        return ifRange == etag_;
+    if(ifRange[0] == 'W')   // A weak entity tag never matches
+        return false;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    return strptime(ifRange.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm) && timegm(&tm) == lastModified_;
+}
+
+// A byte position of the Range header, saturated instead of overflowing, as any position past the content is.
+static off64_t parseBytePos(const std::string& digits) {
+    errno = 0;
+    long long pos = strtoll(digits.c_str(), nullptr, 10);
+    return errno == ERANGE ? LLONG_MAX : pos;
+}
+
+int HttpResponse::setRanges(const std::string& range, const std::string& type){
+    if(!contentComplete_ || !parts_.empty() || range.compare(0, 6, "bytes=") != 0)
+        return 200;
+    off64_t total = contentLen_;
+    std::vector<std::pair<off64_t, off64_t>> ranges; // First and last byte positions
+    static const std::regex pattern(" *([0-9]*)-([0-9]*) *");
+    size_t pos = 6;
+    while(pos <= range.size()) {
+        size_t comma = std::min(range.find(',', pos), range.size());
+        std::smatch subMatch;
+        std::string spec = range.substr(pos, comma - pos);
+        pos = comma + 1;
+        // An invalid Range header is ignored.
+        if(!std::regex_match(spec, subMatch, pattern) || (!subMatch[1].length() && !subMatch[2].length()))
+            return 200;
+        off64_t first, last;
+        if(!subMatch[1].length()) { // Suffix range: the last N bytes
+            off64_t suffix = parseBytePos(subMatch[2]);
+            if(suffix == 0)
+                continue;
+            first = std::max<off64_t>(0, total - suffix);
+            last = total - 1;
+        }
+        else {
+            first = parseBytePos(subMatch[1]);
+            last = total - 1;
+            if(subMatch[2].length()) {
+                if(parseBytePos(subMatch[2]) < first)
+                    return 200;
+                last = std::min<off64_t>(parseBytePos(subMatch[2]), last);
+            }
+        }
+        if(first >= total)  // Unsatisfiable
+            continue;
+        ranges.emplace_back(first, last);
+        if(ranges.size() > MAX_RANGES)
+            return 200;
+    }
+
+    if(ranges.empty()) {
+        dropBody_();
+        addHeader("Content-Range", "bytes */" + std::to_string(total));
+        addHeader("Content-Length", "0");
+        return 416;
+    }
+    // The pre-rendered header has the length of the whole content.
+    contentHeader_.reset();
+    if(ranges.size() == 1) {
+        contentOffset_ = ranges[0].first;
+        contentLen_ = ranges[0].second + 1;
+        addHeader("Content-Type", type);
+        addHeader("Content-Length", std::to_string(contentLen_ - contentOffset_));
+        addHeader("Content-Range", "bytes " + std::to_string(ranges[0].first) + "-" 
+                                 + std::to_string(ranges[0].second) + "/" + std::to_string(total));
+        return 206;
+    }
+
+    char boundary[32];
+    snprintf(boundary, sizeof(boundary), "%08lx%012lx", (unsigned long)boundarySeq_++, (unsigned long)time(nullptr) ^ (unsigned long)total);
+    for(auto& r: ranges) {
+        Part part;
+        part.header = "\r\n--" + std::string(boundary) + "\r\nContent-Type: " + type + "\r\nContent-Range: bytes " 
+                    + std::to_string(r.first) + "-" + std::to_string(r.second) + "/" + std::to_string(total) + "\r\n\r\n";
+        part.begin = r.first;
+        part.end = r.second + 1;
+        pendingLen_ += part.header.size() + part.end - part.begin;
+        parts_.push_back(std::move(part));
+    }
+    parts_.push_back({ "\r\n--" + std::string(boundary) + "--\r\n", 0, 0 });
+    pendingLen_ += parts_.back().header.size();
+    contentOffset_ = contentLen_ = 0;
+    addHeader("Content-Type", "multipart/byteranges; boundary=" + std::string(boundary));
+    addHeader("Content-Length", std::to_string(pendingLen_));
+    return 206;
+}
+
+bool HttpResponse::nextPart(Buffer& buff){
+    if(parts_.empty())
+        return false;
+    Part& part = parts_.front();
+    buff.addData(part.header);
+    contentOffset_ = part.begin;
+    contentLen_ = part.end;
+    pendingLen_ -= part.header.size() + part.end - part.begin;
+    parts_.pop_front();
+    return true;
+}
+
+void HttpResponse::addStream(Producer producer, bool chunked){
+    producer_ = std::move(producer);
+    chunked_ = chunked;
+}
+
+bool HttpResponse::nextChunk(Buffer& buff){
+    if(!producer_)
+        return false;
+    // Gather small pieces into one chunk, so that each is framed and written once.
+    bool more = true;
+    while(more && chunk_.size() < CHUNK_SIZE)
+        more = producer_(chunk_);
+    if(chunk_.size()) {
+        if(chunked_) {
+            char size[24];
+            buff.addData(size, snprintf(size, sizeof(size), "%zx\r\n", chunk_.size()));
+        }
+        buff.addData(chunk_);
+        if(chunked_)
+            buff.addData("\r\n", 2);
+        chunk_.delData(chunk_.size());
+    }
+    if(!more) {
+        if(chunked_)
+            buff.addData("0\r\n\r\n", 5);
+        producer_ = nullptr;
+    }
+    return true;
+}
+
+bool HttpResponse::streaming() const{
+    return producer_ != nullptr;
+}
+
 void HttpResponse::makeMessage(Buffer &buff, int code)
 {
     // make status line
-    code_ = code;
-    std::string status;
-    if(CODE_STATUS.count(code_) == 1)
-        status = CODE_STATUS.find(code_)->second;
-    else {
-        code_ = 400;
-        status = CODE_STATUS.find(400)->second;
-    }
-    buff.addData("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+    const std::string_view* line = STATUS_LINE.find(code);
+    code_ = line ? code : 400;
+    if(!line)
+        line = STATUS_LINE.find(400);
+    buff.addData(line->data(), line->size());
 
     // make response headers
-    for(auto field: header_)
-        buff.addData(field.first + ": " + field.second + "\r\n");
+    buff.addData(dateField_());
+    if(contentHeader_)
+        buff.addData(*contentHeader_);
+    else if(!etag_.empty()) {
+        buff.addData("ETag: " + etag_ + "\r\n");
+        buff.addData("Last-Modified: " + httpDate(lastModified_) + "\r\n");
+    }
+    if(producer_ && chunked_)
+        buff.addData("Transfer-Encoding: chunked\r\n");
+    for(auto& field: header_) {
+        buff.addData(field.first);
+        buff.addData(": ", 2);
+        buff.addData(field.second);
+        buff.addData("\r\n", 2);
+    }
 
-    buff.addData("\r\n");
+    buff.addData("\r\n", 2);
     // LOG_DEBUG("Response Header length:%d\n%s", buff.size(), buff.data());
 }
 
 int HttpResponse::contentFd() const{
-    return contentFd_;
+    return contentFile_ ? contentFile_->fd : -1;
+}
+
+const char* HttpResponse::contentData() const{
+    return contentData_.get();
 }
 
 off64_t HttpResponse::contentLen() const{
@@ -126,6 +405,10 @@ off64_t HttpResponse::contentOffset() const{
     return contentOffset_;
 }
 
+off64_t HttpResponse::pendingLen() const{
+    return pendingLen_;
+}
+
 
 void HttpResponse::contentSend(off64_t len){
     contentOffset_ += len;
@@ -16,10 +16,18 @@
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
+#include <time.h>        // gmtime_r, strptime
 #include <unordered_map>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <functional>
 #include <regex>
 #include <errno.h>
+#include "../cache/fdcache.h"
 #include "../utils/buffer/buffer.h"
+#include "../utils/hash/perfecthash.h"
 #include "../log/log.h"
 
 /**
@@ -32,6 +40,12 @@
  */
 class HttpResponse {
 public:
+    /**
+     * @brief Type of the producer of a streamed body. It appends the next piece 
+     * of the body to the buffer and returns false once the body is complete.
+     */
+    using Producer = std::function<bool(Buffer&)>;
+
     /**
      * @brief Constructor for HttpResponse.
      * To initialze the data structures.
@@ -61,6 +75,80 @@ public:
      */
     bool addBody(std::string& filename);
 
+    /**
+     * @brief Add body of the response message from an open file.
+     * @param file The open file shared with the FdCache.
+     * @param filename A string as the filename.
+     * @return A flag whether it succeeds.
+     */
+    bool addBody(std::shared_ptr<const OpenFile> file, const std::string& filename);
+
+    /**
+     * @brief Add body held in memory.
+     * @param data Pointer to the content, sharing the ownership of its memory.
+     * @param len The length of the content.
+     * @param header Pre-rendered entity header fields of the content.
+     * @return A flag whether it succeeds.
+     */
+    bool addBody(std::shared_ptr<const char> data, off64_t len, std::shared_ptr<const std::string> header);
+
+    /**
+     * @brief Set the validators of the content, which are rendered if the header is not pre-rendered.
+     * @param etag The entity tag (with the quotes).
+     * @param lastModified The modification time of the content.
+     */
+    void setValidators(const std::string& etag, time_t lastModified);
+
+    /**
+     * @brief Evaluate the conditional request, dropping the body if the content is not modified.
+     * @param ifNoneMatch The value of If-None-Match (empty if absent).
+     * @param ifModifiedSince The value of If-Modified-Since (empty if absent).
+     * @return True if the response should be 304 Not Modified.
+     */
+    bool checkNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince);
+
+    /**
+     * @brief Evaluate If-Range, whether the range request applies to the content.
+     * @param ifRange The value of If-Range (empty if absent).
+     */
+    bool checkIfRange(const std::string& ifRange) const;
+
+    /**
+     * @brief Restrict the content to the ranges in the Range header.
+     * @param range The value of Range, such as "bytes=0-499,-500".
+     * @param type The MIME type of the content.
+     * @return 206 if the ranges are set, 416 if none is satisfiable and 200 if the header is ignored.
+     */
+    int setRanges(const std::string& range, const std::string& type);
+
+    /**
+     * @brief Move to the next part of a multipart/byteranges response.
+     * The part header is added to the buffer and the content offset and length 
+     * are set to the range of the part.
+     * @return A flag whether there is a next part.
+     */
+    bool nextPart(Buffer& buff);
+
+    /**
+     * @brief Stream the body from the producer instead of a file or memory.
+     * @param producer The producer, called as the socket drains.
+     * @param chunked Whether to frame the body with chunked transfer coding, 
+     * otherwise it is delimited by closing the connection (for HTTP/1.0).
+     */
+    void addStream(Producer producer, bool chunked);
+
+    /**
+     * @brief Produce the next chunk of the streamed body into the buffer.
+     * The last chunk is followed by the terminating zero-length chunk.
+     * @return A flag whether the stream produced anything.
+     */
+    bool nextChunk(Buffer& buff);
+
+    /**
+     * @brief Whether the streamed body is not finished yet.
+     */
+    bool streaming() const;
+
     /**
      * @brief To make the response message.
      */
@@ -72,31 +160,92 @@ public:
     int contentFd() const;
 
     /**
-     * @brief Get the content length
+     * @brief Get the content in memory (nullptr if the content is in a file)
+     */
+    const char* contentData() const;
+
+    /**
+     * @brief Get the content length, which is the end offset of the current range
      */
     off64_t contentLen() const;
 
     /**
-     * @brief Get the content offset
+     * @brief Get the content offset in the current range
      */
     off64_t contentOffset() const;
 
+    /**
+     * @brief Get the length of the parts after the current range (headers included)
+     */
+    off64_t pendingLen() const;
+
     /**
      * @brief Get the content offset
      */
     void contentSend(off64_t len);
 
+    /**
+     * @brief Get the MIME type by the suffix of the file.
+     */
+    static std::string fileType(const std::string& filepath);
+
+    /**
+     * @brief Check whether the file is worth compressing by its MIME type.
+     */
+    static bool isCompressible(const std::string& filepath);
+
+    /**
+     * @brief Make a strong entity tag from the inode, size and mtime of the file.
+     * @param coding The content-coding of the representation (empty for identity).
+     */
+    static std::string makeETag(const struct stat& st, const std::string& coding = "");
+
+    /**
+     * @brief Format the time as an HTTP-date, such as "Sun, 06 Nov 1994 08:49:37 GMT".
+     */
+    static std::string httpDate(time_t t);
+
 private:
     int code_; // Status code
     std::unordered_map<std::string, std::string> header_; // Fields of response header
     bool contentComplete_;
-    int contentFd_;
+    std::shared_ptr<const OpenFile> contentFile_; // Content in file (if any)
     off64_t contentLen_;
     off64_t contentOffset_;
+    std::shared_ptr<const char> contentData_; // Content in memory (if any)
+    std::shared_ptr<const std::string> contentHeader_; // Pre-rendered header of contentData_
+    std::string etag_;      // Validators of the content
+    time_t lastModified_;
+
+    // A part of a multipart/byteranges response
+    struct Part {
+        std::string header; // Delimiter and header fields of the part
+        off64_t begin;      // Range of the content, end excluded
+        off64_t end;
+    };
+    std::deque<Part> parts_;
+    off64_t pendingLen_;
+
+    Producer producer_;     // Producer of the streamed body (if any)
+    bool chunked_;
+    Buffer chunk_;          // The chunk being produced
+
+    /**
+     * @brief Drop the body and its entity header fields (for 304 and 416).
+     */
+    void dropBody_();
+
+    /**
+     * @brief Get the Date field of the current second, formatted once per second per thread.
+     */
+    static const std::string& dateField_();
+
+    static const size_t MAX_RANGES = 16;
+    static const size_t CHUNK_SIZE = 16 * 1024; // Bytes gathered from the producer before framing a chunk
+    static std::atomic<unsigned long> boundarySeq_;
 
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
-    static const std::unordered_map<int, std::string> CODE_STATUS;
+    // The tables of MIME types and status lines are in httpresponse.cpp.
     // static const std::unordered_map<int, std::string> CODE_PATH;
 
     const std::string CRLF = "\r\n"; // Suffix of Carriage Return Line Feed
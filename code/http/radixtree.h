@@ -0,0 +1,153 @@
+/*
+ * @file        : radixtree.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration and definition of the RadixTree class, which
+ *                is designed for matching request paths against route patterns with ":param"
+ *                and "*wildcard" segments in time proportional to the length of the path.
+ */
+
+#ifndef RADIX_TREE_H
+#define RADIX_TREE_H
+
+#include <assert.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+
+/**
+ * @class RadixTree
+ * @brief The RadixTree class maps route patterns to values, sharing the common prefixes.
+ *
+ * A pattern is a path such as "/user/:id". A ":name" segment captures a non-empty
+ * segment up to the next '/', and a trailing "*name" segment captures the rest of
+ * the path, which may be empty. When several routes match, static segments are
+ * preferred to parameters, and parameters to wildcards.
+ */
+template<class T>
+class RadixTree {
+public:
+    // Captured parameters as (name, value), viewing the pattern and the path matched.
+    using Params = std::vector<std::pair<std::string_view, std::string_view>>;
+
+    RadixTree() : root_(new Node) {}
+
+    /**
+     * @brief Add a route, replacing the value of the same pattern.
+     * @param pattern The route pattern, such as "/user/:id".
+     * @param value The value of the route.
+     */
+    void insert(const std::string& pattern, T value);
+
+    /**
+     * @brief Match the path against the routes.
+     * @param path The path of the request (without the query).
+     * @param params The captured parameters are appended to it, viewing the path.
+     * @return The value of the matched route, nullptr if none matches.
+     */
+    const T* match(std::string_view path, Params& params) const;
+
+private:
+    struct Node {
+        std::string prefix;     // Static part of the path consumed by this node
+        std::vector<std::unique_ptr<Node>> children;   // Static children with distinct first chars
+        std::unique_ptr<Node> param;    // Child matching a ":name" segment
+        std::unique_ptr<Node> wildcard; // Child matching the "*name" rest
+        std::string name;       // Name of the parameter of a param or wildcard node
+        std::unique_ptr<T> value;
+    };
+
+    void insert_(Node* node, std::string_view pattern, T& value);
+    const T* match_(const Node* node, std::string_view path, Params& params) const;
+
+    std::unique_ptr<Node> root_;
+};
+
+template<class T>
+void RadixTree<T>::insert(const std::string& pattern, T value) {
+    insert_(root_.get(), pattern, value);
+}
+
+template<class T>
+void RadixTree<T>::insert_(Node* node, std::string_view pattern, T& value) {
+    if(pattern.empty()) {
+        node->value.reset(new T(std::move(value)));
+        return;
+    }
+    if(pattern[0] == ':' || pattern[0] == '*') {
+        size_t end = pattern[0] == ':' ? std::min(pattern.find('/'), pattern.size()) : pattern.size();
+        std::unique_ptr<Node>& child = pattern[0] == ':' ? node->param : node->wildcard;
+        std::string_view name = pattern.substr(1, end - 1);
+        if(!child) {
+            child.reset(new Node);
+            child->name = std::string(name);
+        }
+        assert(child->name == name);    // A segment is captured by one name among the routes.
+        insert_(child.get(), pattern.substr(end), value);
+        return;
+    }
+    // The static part runs up to the next parameter or wildcard.
+    std::string_view part = pattern.substr(0, std::min(pattern.find_first_of(":*"), pattern.size()));
+    for(auto& child: node->children) {
+        if(child->prefix[0] != part[0])
+            continue;
+        size_t common = 0;
+        while(common < part.size() && common < child->prefix.size() && part[common] == child->prefix[common])
+            common++;
+        if(common < child->prefix.size()) {
+            // Split the child at the end of the common prefix.
+            std::unique_ptr<Node> split(new Node);
+            split->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            split->children.push_back(std::move(child));
+            child = std::move(split);
+        }
+        insert_(child.get(), pattern.substr(common), value);
+        return;
+    }
+    node->children.emplace_back(new Node);
+    node->children.back()->prefix = std::string(part);
+    insert_(node->children.back().get(), pattern.substr(part.size()), value);
+}
+
+template<class T>
+const T* RadixTree<T>::match(std::string_view path, Params& params) const {
+    return match_(root_.get(), path, params);
+}
+
+template<class T>
+const T* RadixTree<T>::match_(const Node* node, std::string_view path, Params& params) const {
+    if(path.empty() && node->value)
+        return node->value.get();
+    if(!path.empty()) {
+        for(auto& child: node->children) {
+            if(child->prefix[0] != path[0])
+                continue;
+            if(path.compare(0, child->prefix.size(), child->prefix) == 0) {
+                const T* value = match_(child.get(), path.substr(child->prefix.size()), params);
+                if(value)
+                    return value;
+            }
+            break;
+        }
+        if(node->param && path[0] != '/') {
+            size_t end = std::min(path.find('/'), path.size());
+            params.emplace_back(node->param->name, path.substr(0, end));
+            const T* value = match_(node->param.get(), path.substr(end), params);
+            if(value)
+                return value;
+            params.pop_back();  // Backtrack to the wildcard
+        }
+    }
+    if(node->wildcard && node->wildcard->value) {
+        params.emplace_back(node->wildcard->name, path);
+        return node->wildcard->value.get();
+    }
+    return nullptr;
+}
+
+#endif //RADIX_TREE_H
@@ -8,6 +8,9 @@
 #include "router.h"
 
 std::string Router::srcDir;
+std::string Router::cacheControl = "no-cache";
+std::shared_ptr<ThreadPool> Router::blockingPool;
+std::shared_ptr<UserStore> Router::userStore;
 
 const std::unordered_map<int, std::string> Router::CODE_PATH = {
     { 400, "/400.html" },
@@ -15,17 +18,137 @@ const std::unordered_map<int, std::string> Router::CODE_PATH = {
     { 404, "/404.html" },
 };
 
-bool Router::getResource_(HttpConn& connection, std::string path_to_file){
-    setConnectionHeaders_(connection);
+const std::vector<std::pair<std::string, std::string>> Router::PRECOMPRESSED = {
+    { "br",   ".br" },
+    { "gzip", ".gz" },
+};
+
+bool Router::addPrecompressed_(HttpConn& connection, const std::string& path_to_file){
+    std::string fileName = srcDir;
+    fileName += path_to_file;
+    double bestQuality = 0;
+    std::shared_ptr<const OpenFile> best, origin;
+    const std::string* bestCoding = nullptr;
+    for(auto& coding: PRECOMPRESSED) {
+        double quality = connection.request_.encodingQuality(coding.first);
+        if(quality <= bestQuality)
+            continue;
+        std::string path = path_to_file + coding.second;
+        if(NegativeCache::Instance()->contains(path))
+            continue;
+        auto file = FdCache::Instance()->get(path, fileName + coding.second);
+        if(!file) {
+            NegativeCache::Instance()->add(path);
+            continue;
+        }
+        // Skip the sibling which is older than the resource itself.
+        if(!origin && !(origin = FdCache::Instance()->get(path_to_file, fileName)))
+            return false;
+        if(file->st.st_mtime < origin->st.st_mtime)
+            continue;
+        best = std::move(file);
+        bestQuality = quality;
+        bestCoding = &coding.first;
+    }
+    if(!best)
+        return false;
+    LOG_DEBUG("Respond Client [%d] with %s encoded %s", connection.getFd(), bestCoding->c_str(), fileName.c_str());
+    connection.response_.addHeader("Content-Encoding", *bestCoding);
+    // The MIME type is the one of the resource, not of the sibling.
+    return connection.response_.addBody(std::move(best), fileName);
+}
+
+bool Router::addEntry_(HttpConn& connection, const std::shared_ptr<const StaticCache::Entry>& entry){
+    connection.response_.setValidators(entry->etag, entry->lastModified);
+    return connection.response_.addBody(std::shared_ptr<const char>(entry, entry->body.data()), entry->body.size(), 
+                                        std::shared_ptr<const std::string>(entry, &entry->header));
+}
+
+bool Router::addEntry_(HttpConn& connection, const std::shared_ptr<const MappedFile>& file){
+    connection.response_.setValidators(file->etag, file->lastModified);
+    return connection.response_.addBody(std::shared_ptr<const char>(file, file->data), file->len, 
+                                        std::shared_ptr<const std::string>(file, &file->header));
+}
+
+const std::vector<std::string> Router::COMPRESSIBLE = { "gzip", "deflate" };
+
+bool Router::addCompressed_(HttpConn& connection, const std::string& path_to_file){
+    double bestQuality = 0;
+    const std::string* bestCoding = nullptr;
+    for(auto& coding: COMPRESSIBLE) {
+        double quality = connection.request_.encodingQuality(coding);
+        if(quality > bestQuality) {
+            bestQuality = quality;
+            bestCoding = &coding;
+        }
+    }
+    if(!bestCoding)
+        return false;
+    std::string fileName = srcDir;
+    fileName += path_to_file;
+    auto file = FdCache::Instance()->get(path_to_file, fileName);
+    if(!file)
+        return false;
+    auto entry = CompressCache::Instance()->get(path_to_file, *file, *bestCoding);
+    if(!entry)
+        return false;
+    return addEntry_(connection, entry);
+}
+
+bool Router::addResource_(HttpConn& connection, const std::string& path_to_file){
     std::string fileName = srcDir;
     fileName += path_to_file;
     LOG_DEBUG("Respond Client [%d] \"GET %s\" with %s", connection.getFd(), connection.request_.url().c_str(), fileName.c_str());
-    connection.response_.addBody(fileName);
-    connection.response_.makeMessage(connection.writeBuff_, 200);
+    if(HttpResponse::isCompressible(fileName)) {
+        connection.response_.addHeader("Vary", "Accept-Encoding");
+        // Ranges of the content compressed on the fly are not supported.
+        if(addPrecompressed_(connection, path_to_file) || 
+           (connection.request_.getHeader("Range").empty() && addCompressed_(connection, path_to_file)))
+            return true;
+    }
+    auto entry = StaticCache::Instance()->get(path_to_file, fileName);
+    if(entry)   // Serve from memory with the pre-rendered header
+        return addEntry_(connection, entry);
+    auto file = FdCache::Instance()->get(path_to_file, fileName);
+    if(!file)
+        return false;
+    auto mapped = MmapCache::Instance()->get(path_to_file, *file);
+    if(mapped)  // Write the hot file from the shared mapping
+        return addEntry_(connection, mapped);
+    return connection.response_.addBody(std::move(file), fileName); // Share the open file with concurrent downloads
+}
+
+bool Router::getResource_(HttpConn& connection, std::string_view path){
+    setConnectionHeaders_(connection);
+    std::string path_to_file(path);
+    int code = 200;
+    if(addResource_(connection, path_to_file)) {
+        connection.response_.addHeader("Cache-Control", cacheControl);
+        connection.response_.addHeader("Accept-Ranges", "bytes");
+        if(connection.request_.method() == "GET") {
+            std::string range = connection.request_.getHeader("Range");
+            if(connection.response_.checkNotModified(connection.request_.getHeader("If-None-Match"), 
+                                                     connection.request_.getHeader("If-Modified-Since")))
+                code = 304;
+            else if(!range.empty() && connection.response_.checkIfRange(connection.request_.getHeader("If-Range")))
+                code = connection.response_.setRanges(range, HttpResponse::fileType(path_to_file));
+        }
+    }
+    connection.response_.makeMessage(connection.writeBuff_, code);
     return true; 
 }
 
-bool Router::userVerify_(HttpConn& connection){
+bool Router::streamResponse(HttpConn& connection, const std::string& type, HttpResponse::Producer producer){
+    setConnectionHeaders_(connection);
+    // HTTP/1.0 connections are not kept alive, so closing marks the end of an unframed body.
+    bool chunked = connection.request_.version() == "1.1";
+    connection.response_.addHeader("Content-Type", type);
+    connection.response_.addStream(std::move(producer), chunked);
+    connection.response_.makeMessage(connection.writeBuff_, 200);
+    return true;
+}
+
+bool Router::userVerify_(HttpConn& connection, std::string_view){
     if(!connection.request_.parseURL(connection.readBuff_))
         return false;
     std::string name = connection.request_.getPost("username");
@@ -35,42 +158,17 @@ bool Router::userVerify_(HttpConn& connection){
     }
 
     LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-    assert(sql);
-
-    bool flag = false;
-    char order[256];
-    snprintf(order, 256, "SELECT password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", order);
-
-    if (mysql_query(sql, order)) {
-        LOG_DEBUG("Query error!");
-        return false;
-    }
-
-    MYSQL_RES* res = mysql_store_result(sql);
-    MYSQL_ROW row = mysql_fetch_row(res);
-    if (row) {
-        LOG_DEBUG("MYSQL ROW: %s", row[0]);
-        std::string password(row[0]);
-        flag = pwd == password;
-        if (!flag) 
-            LOG_DEBUG("Password error!");
-    } 
-    else {
-        LOG_DEBUG("User not found!");
-        flag = false;
-    }
-
-    mysql_free_result(res);
-    if(flag)
-        return getResource_(connection, "/welcome.html");
-    else
-        return getResource_(connection, "/error.html");
+    bool flag;
+    if(userStore->tryVerify(name, pwd, flag))
+        return getResource_(connection, flag ? "/welcome.html" : "/error.html");
+    return await_<bool>(connection, [name, pwd](std::function<void(bool)> done) {
+        userStore->verify(name, pwd, std::move(done));
+    }, [](HttpConn& conn, bool flag) {
+        getResource_(conn, flag ? "/welcome.html" : "/error.html");
+    });
 }
 
-bool Router::userCreate_(HttpConn& connection){
+bool Router::userCreate_(HttpConn& connection, std::string_view){
     if(!connection.request_.parseURL(connection.readBuff_))
         return false;
     std::string name = connection.request_.getPost("username");
@@ -80,68 +178,59 @@ bool Router::userCreate_(HttpConn& connection){
     }
 
     LOG_INFO("Create name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII(&sql, SqlConnPool::Instance());
-    assert(sql);
+    bool flag;
+    if(userStore->tryCreate(name, pwd, flag))
+        return getResource_(connection, flag ? "/welcome.html" : "/error.html");
+    return await_<bool>(connection, [name, pwd](std::function<void(bool)> done) {
+        userStore->create(name, pwd, std::move(done));
+    }, [](HttpConn& conn, bool flag) {
+        getResource_(conn, flag ? "/welcome.html" : "/error.html");
+    });
+}
 
-    bool flag = true;
-    char order[256];
-    snprintf(order, 256, "SELECT password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", order);
+void Router::addRoute_(const std::string& method, const std::string& url, HandlerFunc handler, std::string_view arg) {
+    routes[method].insert(url, Route{ handler, arg });
+    RouteCache::Instance()->clear();    // The new route may shadow the resolved targets
+}
 
-    if (mysql_query(sql, order)) {
-        LOG_DEBUG("Query error!");
-        return false;
-    }
+void Router::loadRoutes_() {
+    // The routes of fixed URLs are in findStaticRoute_, add the routes with parameters here, such as
+    // addRoute_("GET", "/user/:id", userProfile_).
+}
 
-    MYSQL_RES* res = mysql_store_result(sql);
-    MYSQL_ROW row = mysql_fetch_row(res);
-    if (row) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        flag = false;
-        LOG_DEBUG("Username used!");
-    } 
-    mysql_free_result(res);
-
-    LOG_DEBUG("register!");
-    bzero(order, 256);
-    snprintf(order, 256,"INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-    LOG_DEBUG( "%s", order);
-    if(mysql_query(sql, order)) { 
-        LOG_DEBUG( "Insert error!");
-        flag = false; 
-    }
+// Key of the routes of fixed URLs.
+struct StaticRouteKey {
+    std::string_view method;
+    std::string_view path;
 
-    if(flag)
-        getResource_(connection, "/welcome.html");
-    else
-        getResource_(connection, "/error.html");
-    return true;
-}
+    constexpr bool operator==(const StaticRouteKey& other) const {
+        return method == other.method && path == other.path;
+    }
+};
 
-void Router::addRoute_(const std::string& method, const std::string& url, HandlerFunc handler) {
-    routes[method][url] = handler;
+constexpr uint32_t perfectHashOf(const StaticRouteKey& key, uint32_t seed) {
+    return perfectHashOf(key.path, perfectHashOf(key.method, seed));
 }
 
-void Router::loadRoutes_() {
-    addRoute_("GET", "/", std::bind(&Router::getResource_, std::placeholders::_1, "/index.html"));
-    addRoute_("GET", "/index", std::bind(&Router::getResource_, std::placeholders::_1, "/index.html"));
-    addRoute_("GET", "/register", std::bind(&Router::getResource_, std::placeholders::_1, "/register.html"));
-    addRoute_("GET", "/login", std::bind(&Router::getResource_, std::placeholders::_1, "/login.html"));
-    addRoute_("GET", "/welcome", std::bind(&Router::getResource_, std::placeholders::_1, "/welcome.html"));
-    addRoute_("GET", "/video", std::bind(&Router::getResource_, std::placeholders::_1, "/video.html"));
-    addRoute_("GET", "/picture", std::bind(&Router::getResource_, std::placeholders::_1, "/picture.html"));
-
-    addRoute_("POST", "/register", userCreate_);
-    addRoute_("POST", "/login", userVerify_);
+const Route* Router::findStaticRoute_(std::string_view method, std::string_view path) {
+    static constexpr auto ROUTES = makePerfectHash<StaticRouteKey, Route>({
+        { { "GET",  "/" },          { &getResource_, "/index.html" } },
+        { { "GET",  "/index" },     { &getResource_, "/index.html" } },
+        { { "GET",  "/register" },  { &getResource_, "/register.html" } },
+        { { "GET",  "/login" },     { &getResource_, "/login.html" } },
+        { { "GET",  "/welcome" },   { &getResource_, "/welcome.html" } },
+        { { "GET",  "/video" },     { &getResource_, "/video.html" } },
+        { { "GET",  "/picture" },   { &getResource_, "/picture.html" } },
+        { { "POST", "/register" },  { &userCreate_ } },
+        { { "POST", "/login" },     { &userVerify_ } },
+    });
+    return ROUTES.find({ method, path });
 }
 
-bool Router::errorHandler_(HttpConn& connection) {
-    // Try to GET an unknown URL
+bool Router::errorHandler_(HttpConn& connection, std::string_view) {
+    // Try to GET an unknown URL, the page is usually served from StaticCache
     setConnectionHeaders_(connection);
-    std::string fileName = srcDir;
-    fileName += "/404.html";
-    connection.response_.addBody(fileName);
+    addResource_(connection, CODE_PATH.at(404));
     connection.response_.makeMessage(connection.writeBuff_, 404);
     return true;
 }
@@ -158,22 +247,39 @@ bool Router::errorHandler_(HttpConn& connection) {
 //     return errorHandler_(connection);
 // }
 
-std::function<bool(HttpConn&)> Router::getHandler(HttpConn& connection) {
-    auto methodIt = routes.find(connection.request_.method());
-    if (methodIt != routes.end()) {
-        auto& pathMap = methodIt->second;
-        auto pathIt = pathMap.find(connection.request_.url());
-        if (pathIt != pathMap.end()) {
-            return pathIt->second;
-        }
-        else if(connection.request_.method() == "GET"){
-            // Handler not found, check the resource
-            std::string fileName = srcDir;
-            fileName += connection.request_.url();
-            struct stat filestat;
-            if(stat(fileName.c_str(), &filestat) == 0)     // File Exists               
-               return std::bind(&Router::getResource_, std::placeholders::_1, connection.request_.url());
+Route Router::getHandler(HttpConn& connection) {
+    std::string method = connection.request_.method();
+    std::string_view path = connection.request_.path();
+    const Route* route = findStaticRoute_(method, path);
+    if(route)
+        return *route;
+    auto resolved = RouteCache::Instance()->get(method, path);
+    if(resolved) {  // Requested before, skip the routing and the file system
+        connection.cachedTarget = resolved;
+        return resolved->route;
+    }
+    auto methodIt = routes.find(method);
+    if(methodIt != routes.end()) {
+        route = methodIt->second.match(path, connection.request_.params_);
+        if(route)
+            return *route;
+    }
+    if(method == "GET") {
+        // Handler not found, check the resource
+        std::string url(path);
+        if(NegativeCache::Instance()->contains(url))    // Missing recently
+            return { &errorHandler_ };
+        std::string fileName = srcDir;
+        fileName += url;
+        if(FdCache::Instance()->get(url, fileName)) {   // File Exists
+            resolved = RouteCache::Instance()->add(method, path, &getResource_);
+            if(resolved) {
+                connection.cachedTarget = resolved;
+                return resolved->route;
+            }
+            return { &getResource_, path };             // The path views the URL kept by the request
         }
+        NegativeCache::Instance()->add(url);
     }
-    return &errorHandler_;
-}
\ No newline at end of file
+    return { &errorHandler_ };
+}
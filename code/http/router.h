@@ -20,8 +20,18 @@
 #include <unordered_map>
 #include <functional>
 #include <string>
+#include <vector>
 #include "httpconn.h"
+#include "radixtree.h"
+#include "../cache/staticcache.h"
+#include "../cache/fdcache.h"
+#include "../cache/negativecache.h"
+#include "../cache/compresscache.h"
+#include "../cache/mmapcache.h"
+#include "../cache/routecache.h"
 #include "../utils/buffer/buffer.h"
+#include "../pool/threadpool.h"
+#include "../store/userstore.h"
 #include "../log/log.h"
 
 
@@ -35,9 +45,9 @@
 class Router {
 public:
     /**
-     * @brief Type definition for handler functions.
+     * @brief Type definition for handler functions, called with the argument of their route.
      */
-    using HandlerFunc = std::function<bool(HttpConn&)>;
+    using HandlerFunc = Route::Handler;
 
     /**
      * @brief Constructor for Router.
@@ -55,11 +65,24 @@ public:
     /**
      * @brief Routes the request to the appropriate handler.
      * @param connection The HTTP connection.
-     * @return True if the request was handled successfully, false otherwise.
+     * @return The route of the request.
      */
-    HandlerFunc getHandler(HttpConn& connection);
+    Route getHandler(HttpConn& connection);
 
     static std::string srcDir;
+    static std::string cacheControl;    // Cache-Control of static resources
+    static std::shared_ptr<ThreadPool> blockingPool;   // Runs the blocking work of handlers (set by the server)
+    static std::shared_ptr<UserStore> userStore;       // Keeps the users of login and registration (set by the server)
+
+    /**
+     * @brief Respond the request with a body generated incrementally, such as an export or a listing.
+     * The body is chunked for HTTP/1.1 and delimited by closing the connection for HTTP/1.0.
+     * @param connection The HTTP connection.
+     * @param type The MIME type of the body.
+     * @param producer The producer of the body, called by the write loop as the socket drains.
+     * @return True if the request was handled successfully.
+     */
+    static bool streamResponse(HttpConn& connection, const std::string& type, HttpResponse::Producer producer);
 
 private:
     /**
@@ -67,12 +90,18 @@ private:
      */
     void loadRoutes_();
 
-    // To store the mapping from method and URL to handlers.
-    std::unordered_map<std::string, std::unordered_map<std::string, HandlerFunc>> routes;
+    /**
+     * @brief Find the route of a fixed URL in the table built at compile time.
+     * @return The route, nullptr if the URL has no fixed route.
+     */
+    static const Route* findStaticRoute_(std::string_view method, std::string_view path);
+
+    // To store the mapping from method and path pattern to handlers, for the routes with parameters.
+    std::unordered_map<std::string, RadixTree<Route>> routes;
     
 
-    // Utility to add a route to the map
-    void addRoute_(const std::string& method, const std::string& url, HandlerFunc handler); 
+    // Utility to add a route to the map, the url may contain ":param" and "*wildcard" segments
+    void addRoute_(const std::string& method, const std::string& url, HandlerFunc handler, std::string_view arg = {}); 
 
     inline static void setConnectionHeaders_(HttpConn& connection) {
         connection.response_.clear();
@@ -92,21 +121,61 @@ private:
      * @param connection The HTTP connection.
      * @return True if the request was handled successfully, false otherwise.
      */
-    static bool errorHandler_(HttpConn&);
+    static bool errorHandler_(HttpConn&, std::string_view = {});
+
+    /**
+     * @brief Run the blocking work off the worker thread and respond with its result later.
+     * The connection is suspended until the completion has made the response, so the 
+     * worker is free for other connections while the work runs on blockingPool.
+     * @param connection The HTTP connection.
+     * @param work The blocking work, such as a query, returning its result.
+     * @param completion Makes the response from the result, called as completion(connection, result).
+     * @return The return value of the handler (false once suspended).
+     */
+    template<class Work, class Completion>
+    static bool async_(HttpConn& connection, Work work, Completion completion) {
+        if(!blockingPool) {
+            completion(connection, work());
+            return true;
+        }
+        HttpConn::Resumer resume = connection.suspend();
+        blockingPool->AddTask([work = std::move(work), completion = std::move(completion), resume = std::move(resume)]() {
+            auto result = work();
+            resume([result = std::move(result), completion](HttpConn& conn) { completion(conn, result); });
+        });
+        return false;
+    }
+
+    /**
+     * @brief Respond with the result of nonblocking work, such as queries on SqlAsync, later.
+     * The connection is suspended until the completion has made the response.
+     * @param connection The HTTP connection.
+     * @param start Starts the work, called as start(done), where done(result) may be called from any thread.
+     * @param completion Makes the response from the result, called as completion(connection, result).
+     * @return The return value of the handler (false once suspended).
+     */
+    template<class Result, class Start, class Completion>
+    static bool await_(HttpConn& connection, Start start, Completion completion) {
+        HttpConn::Resumer resume = connection.suspend();
+        start([resume = std::move(resume), completion = std::move(completion)](Result result) {
+            resume([result = std::move(result), completion](HttpConn& conn) { completion(conn, result); });
+        });
+        return false;
+    }
 
     /**
      * @brief Verify the user and password in the request.
      * @param connection The HTTP connection.
      * @return True if the request was handled successfully, false otherwise.
      */
-    static bool userVerify_(HttpConn& connection);
+    static bool userVerify_(HttpConn& connection, std::string_view = {});
 
     /**
      * @brief Create the user with password in the request.
      * @param connection The HTTP connection.
      * @return True if the request was handled successfully, false otherwise.
      */
-    static bool userCreate_(HttpConn& connection);
+    static bool userCreate_(HttpConn& connection, std::string_view = {});
 
     /**
      * @brief Respond the request with the resource.
@@ -114,7 +183,53 @@ private:
      * @param path_to_file The path to the resource file.
      * @return True if the request was handled successfully, false otherwise.
      */
-    static bool getResource_(HttpConn& connection, std::string path_to_file);
+    static bool getResource_(HttpConn& connection, std::string_view path_to_file);
+
+    /**
+     * @brief Add the resource as the body of response, from the caches if possible.
+     * @param connection The HTTP connection.
+     * @param path_to_file The path to the resource file.
+     * @return True if the resource is found.
+     */
+    static bool addResource_(HttpConn& connection, const std::string& path_to_file);
+
+    /**
+     * @brief Add the cached entry as the body of response.
+     * @param connection The HTTP connection.
+     * @param entry The entry from StaticCache or CompressCache.
+     * @return True if the entry is added.
+     */
+    static bool addEntry_(HttpConn& connection, const std::shared_ptr<const StaticCache::Entry>& entry);
+
+    /**
+     * @brief Add a shared mapping from MmapCache as the body of the response.
+     * @param connection The HTTP connection.
+     * @param file The mapping of the file.
+     * @return True if the mapping is added.
+     */
+    static bool addEntry_(HttpConn& connection, const std::shared_ptr<const MappedFile>& file);
+
+    /**
+     * @brief Add the precompressed sibling (.br or .gz) of the resource, if the client accepts it.
+     * @param connection The HTTP connection.
+     * @param path_to_file The path to the resource file.
+     * @return True if a sibling is added.
+     */
+    static bool addPrecompressed_(HttpConn& connection, const std::string& path_to_file);
+
+    /**
+     * @brief Add the resource compressed on the fly (from CompressCache), if the client accepts it.
+     * @param connection The HTTP connection.
+     * @param path_to_file The path to the resource file.
+     * @return True if the compressed resource is added.
+     */
+    static bool addCompressed_(HttpConn& connection, const std::string& path_to_file);
+
+    // Content-codings supported by CompressCache, in the order of preference
+    static const std::vector<std::string> COMPRESSIBLE;
+
+    // Content-codings of precompressed siblings and their suffixes, in the order of preference
+    static const std::vector<std::pair<std::string, std::string>> PRECOMPRESSED;
 
     static const std::unordered_map<int, std::string> CODE_PATH;
 };
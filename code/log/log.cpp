@@ -9,37 +9,41 @@
 
 using namespace std;
 
+thread_local Log::Producer Log::producer_;
+
 Log::Log() {
     lineCount_ = 0;
+    fileIndex_ = 0;
+    isOpen_ = false;
+    level_ = 1;
     isAsync_ = false;
     writeThread_ = nullptr;
-    deque_ = nullptr;
     toDay_ = 0;
     fp_ = nullptr;
+    ringSize_ = 0;
+    sleeping_ = false;
+    closed_ = false;
 }
 
 Log::~Log() {
     if(writeThread_ && writeThread_->joinable()) {
-        while(!deque_->empty()) {
-            deque_->flush();
-        };
-        deque_->Close();
+        // The writer drains the rings once more before it returns.
+        closed_ = true;
+        wakeCond_.notify_one();
         writeThread_->join();
     }
     if(fp_) {
         lock_guard<mutex> locker(mtx_);
-        flush();
+        fflush(fp_);
         fclose(fp_);
     }
 }
 
 int Log::GetLevel() {
-    lock_guard<mutex> locker(mtx_);
     return level_;
 }
 
 void Log::SetLevel(int level) {
-    lock_guard<mutex> locker(mtx_);
     level_ = level;
 }
 
@@ -48,35 +52,33 @@ void Log::init(int level = 1, const char* path, const char* suffix,
     isOpen_ = true;
     level_ = level;
     if(maxQueueSize > 0) {
+        // A power of two, which holds two of the longest lines at least.
+        size_t size = 2 * LINE_SIZE;
+        while(size < maxQueueSize * AVG_LINE_SIZE)
+            size <<= 1;
+        ringSize_ = size;
         isAsync_ = true;
-        if(!deque_) {
-            unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
-            deque_ = move(newDeque);
-            
-            std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
-            writeThread_ = move(NewThread);
-        }
     } else {
         isAsync_ = false;
     }
 
-    lineCount_ = 0;
-
     time_t timer = time(nullptr);
-    struct tm *sysTime = localtime(&timer);
-    struct tm t = *sysTime;
-    path_ = path;
-    suffix_ = suffix;
+    struct tm t;
+    localtime_r(&timer, &t);
     char fileName[LOG_NAME_LEN] = {0};
     snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s", 
-            path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    toDay_ = t.tm_mday;
+            path, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix);
 
     {
+        // The writer rotates the file with the path, so it is changed under the lock too.
         lock_guard<mutex> locker(mtx_);
-        buff_.delData(buff_.size());
+        path_ = path;
+        suffix_ = suffix;
+        lineCount_ = 0;
+        fileIndex_ = 0;
+        toDay_ = t.tm_mday;
         if(fp_) { 
-            flush();
+            fflush(fp_);
             fclose(fp_); 
         }
 
@@ -87,99 +89,170 @@ void Log::init(int level = 1, const char* path, const char* suffix,
         } 
         assert(fp_ != nullptr);
     }
+    if(isAsync_ && !writeThread_) {
+        std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
+        writeThread_ = move(NewThread);
+    }
 }
 
 void Log::write(int level, const char *format, ...) {
+    Producer& producer = producer_;
     struct timeval now = {0, 0};
     gettimeofday(&now, nullptr);
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    if(now.tv_sec != producer.second) {
+        producer.second = now.tv_sec;
+        localtime_r(&producer.second, &producer.t);
+    }
+    const struct tm& t = producer.t;
     va_list vaList;
 
-    /* 日志日期 日志行数 */
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0)))
-    {
-        unique_lock<mutex> locker(mtx_);
-        locker.unlock();
-        
-        char newFile[LOG_NAME_LEN];
-        char tail[36] = {0};
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
-
-        if (toDay_ != t.tm_mday)
-        {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;
-            lineCount_ = 0;
-        }
-        else {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_  / MAX_LINES), suffix_);
+    int len = snprintf(producer.line, LINE_SIZE, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s",
+                       t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+                       t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec, LogLevelTitle_(level));
+    // Leave a byte for the newline, which ends even a line cut short.
+    size_t room = LINE_SIZE - len - 1;
+    va_start(vaList, format);
+    int n = vsnprintf(producer.line + len, room, format, vaList);
+    va_end(vaList);
+    if(n > 0)
+        len += std::min((size_t)n, room - 1);
+    producer.line[len++] = '\n';
+
+    if(isAsync_) {
+        LogRing* ring = ring_();
+        while(!ring->push(producer.line, len)) {
+            wake_();
+            std::this_thread::yield();
         }
-        
-        locker.lock();
-        flush();
-        fclose(fp_);
-        fp_ = fopen(newFile, "a");
-        assert(fp_ != nullptr);
+        return;
+    }
+    lock_guard<mutex> locker(mtx_);
+    rotate_(t);
+    fwrite(producer.line, 1, len, fp_);
+    lineCount_++;
+}
+
+LogRing* Log::ring_() {
+    if(!producer_.ring) {
+        producer_.ring = std::make_shared<LogRing>(ringSize_);
+        lock_guard<mutex> locker(ringsMtx_);
+        rings_.push_back(producer_.ring);
     }
+    return producer_.ring.get();
+}
 
+void Log::rotate_(const struct tm& t) {
+    if(toDay_ == t.tm_mday && lineCount_ < (fileIndex_ + 1) * MAX_LINES)
+        return;
+    char newFile[LOG_NAME_LEN];
+    char tail[36] = {0};
+    snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+
+    if (toDay_ != t.tm_mday)
     {
-        unique_lock<mutex> locker(mtx_);
-        lineCount_++;
-                    
-        buff_.strPrintf("%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        AppendLogLevelTitle_(level);
-
-        va_start(vaList, format);
-        buff_.vecPrintf(format, vaList);
-        va_end(vaList);
-
-        buff_.addData("\n\0", 2);
-
-        if(isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.getData(buff_.size()));
-        } else {
-            fputs(buff_.data(), fp_);
-        }
-        buff_.delData(buff_.size());
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
+        toDay_ = t.tm_mday;
+        lineCount_ = 0;
+        fileIndex_ = 0;
     }
+    else {
+        fileIndex_ = lineCount_ / MAX_LINES;
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, fileIndex_, suffix_);
+    }
+    
+    fflush(fp_);
+    fclose(fp_);
+    fp_ = fopen(newFile, "a");
+    assert(fp_ != nullptr);
 }
 
-void Log::AppendLogLevelTitle_(int level) {
+const char* Log::LogLevelTitle_(int level) {
     switch(level) {
     case 0:
-        buff_.addData("[debug]: ", 9);
-        break;
-    case 1:
-        buff_.addData("[info] : ", 9);
-        break;
+        return "[debug]: ";
     case 2:
-        buff_.addData("[warn] : ", 9);
-        break;
+        return "[warn] : ";
     case 3:
-        buff_.addData("[error]: ", 9);
-        break;
+        return "[error]: ";
     default:
-        buff_.addData("[info] : ", 9);
-        break;
+        return "[info] : ";
     }
 }
 
 void Log::flush() {
-    if(isAsync_) { 
-        deque_->flush(); 
+    if(isAsync_) {
+        wake_();    // The writer flushes the file after each round
+        return;
     }
+    lock_guard<mutex> locker(mtx_);
     fflush(fp_);
 }
 
-void Log::AsyncWrite_() {
-    string str = "";
-    while(deque_->pop(str)) {
+void Log::wake_() {
+    // Cleared by the first producer seeing it, so the others skip the notification.
+    if(sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false))
+        wakeCond_.notify_one();
+}
+
+size_t Log::drain_() {
+    {
+        lock_guard<mutex> locker(ringsMtx_);
+        draining_ = rings_;
+    }
+    struct timeval now = {0, 0};
+    gettimeofday(&now, nullptr);
+    struct tm t;
+    localtime_r(&now.tv_sec, &t);
+    size_t total = 0;
+    bool closed = false;
+    {
+        // Lines are counted by rounds, so a file may exceed MAX_LINES by a round.
         lock_guard<mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+        rotate_(t);
+        for(auto& ring: draining_) {
+            closed |= ring->closed();   // Before taking its last lines
+            std::pair<const char*, size_t> second;
+            std::pair<const char*, size_t> first = ring->peek(second);
+            for(auto& part: { first, second }) {
+                if(part.second == 0)
+                    continue;
+                fwrite(part.first, 1, part.second, fp_);
+                lineCount_ += std::count(part.first, part.first + part.second, '\n');
+            }
+            ring->pop(first.second + second.second);
+            total += first.second + second.second;
+        }
+        if(total > 0)
+            fflush(fp_);
+    }
+    if(closed) {
+        // Drop the rings of the threads exited, once they are empty.
+        lock_guard<mutex> locker(ringsMtx_);
+        for(auto it = rings_.begin(); it != rings_.end(); ) {
+            if((*it)->closed() && (*it)->empty())
+                it = rings_.erase(it);
+            else
+                ++it;
+        }
+    }
+    draining_.clear();
+    return total;
+}
+
+void Log::AsyncWrite_() {
+    while(true) {
+        bool closing = closed_;     // Read first, so the lines before closing are drained
+        if(drain_() > 0)
+            continue;
+        if(closing)
+            return;
+        unique_lock<mutex> locker(wakeMtx_);
+        sleeping_ = true;
+        // A line pushed as the writer falls asleep may miss the notification, so it sleeps for a while at most.
+        wakeCond_.wait_for(locker, std::chrono::milliseconds(WAKE_INTERVAL_MS), [this]() {
+            return !sleeping_ || closed_;
+        });
+        sleeping_ = false;
     }
 }
 
@@ -190,4 +263,4 @@ Log* Log::Instance() {
 
 void Log::FlushLogThread() {
     Log::Instance()->AsyncWrite_();
-}
\ No newline at end of file
+}
@@ -11,16 +11,32 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
 #include <sys/time.h>
 #include <string.h>
 #include <stdarg.h>           // vastart va_end
 #include <assert.h>
 #include <sys/stat.h>         //mkdir
-#include "blockqueue.h"
+#include "logring.h"
 #include "../utils/buffer/buffer.h"
 
+/**
+ * @class Log
+ * @brief The Log class is used to write the log lines to daily files.
+ *
+ * In the async mode each thread formats its lines into its own LogRing, without a
+ * lock or an allocation once the ring is made, and a single thread drains the rings
+ * into the file in batches, flushing the file once per round. A thread finding its
+ * ring full waits for the writer. The lines of different threads are in the order
+ * they are drained, which is close to, but not exactly, the order of their times.
+ */
 class Log {
 public:
+    /**
+     * @param maxQueueCapacity The lines buffered by each thread (0 to write the lines at once).
+     */
     void init(int level, const char* path = "./log", 
                 const char* suffix =".log",
                 int maxQueueCapacity = 1024);
@@ -37,33 +53,77 @@ public:
     
 private:
     Log();
-    void AppendLogLevelTitle_(int level);
+    static const char* LogLevelTitle_(int level);
     virtual ~Log();
     void AsyncWrite_();
 
+    /**
+     * @brief The ring and the formatting state of a thread.
+     */
+    struct Producer {
+        std::shared_ptr<LogRing> ring;
+        time_t second = -1;     // The time of the last line, converted once per second
+        struct tm t;
+        char line[4096];
+        ~Producer() { if(ring) ring->close(); }
+    };
+
+    /**
+     * @brief Get the ring of the calling thread, made on its first line.
+     */
+    LogRing* ring_();
+
+    /**
+     * @brief Wake the writer if it sleeps.
+     */
+    void wake_();
+
+    /**
+     * @brief Write the lines of every ring to the file.
+     * @return The number of bytes written.
+     */
+    size_t drain_();
+
+    /**
+     * @brief Open the next file if the day changed or the file is full, the caller should hold mtx_.
+     */
+    void rotate_(const struct tm& t);
+
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
     static const int MAX_LINES = 50000;
+    static const size_t LINE_SIZE = sizeof(Producer::line);    // Longer lines are cut
+    static const size_t AVG_LINE_SIZE = 128;    // To size the rings by lines
+    static const int WAKE_INTERVAL_MS = 100;    // Max time the writer sleeps
+
+    static thread_local Producer producer_;
 
     const char* path_;
     const char* suffix_;
 
-    int MAX_LINES_;
-
-    int lineCount_;
+    int lineCount_;     // Lines of the day
+    int fileIndex_;     // Files of the day before this one
     int toDay_;
 
-    bool isOpen_;
+    std::atomic<bool> isOpen_;
  
-    Buffer buff_;
-    int level_;
-    bool isAsync_;
+    std::atomic<int> level_;
+    std::atomic<bool> isAsync_;
 
     FILE* fp_;
-    std::unique_ptr<BlockDeque<std::string>> deque_; 
+    std::mutex mtx_;    // Guards the file
+
+    std::atomic<size_t> ringSize_;  // Of the rings made from now on
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::vector<std::shared_ptr<LogRing>> draining_;    // Copy of rings_ used by the writer
+    std::mutex ringsMtx_;
+
     std::unique_ptr<std::thread> writeThread_;
-    std::mutex mtx_;
+    std::atomic<bool> sleeping_;
+    std::atomic<bool> closed_;
+    std::mutex wakeMtx_;
+    std::condition_variable wakeCond_;
 };
 
 #define LOG_BASE(level, format, ...) \
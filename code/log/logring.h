@@ -0,0 +1,97 @@
+/*
+ * @file        : logring.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration and implementation of the LogRing class, which is
+ *                designed for passing the formatted lines of a thread to the writer of Log without locks.
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+/**
+ * @class LogRing
+ * @brief The LogRing class is a ring of bytes with a single producer and a single consumer.
+ *
+ * The producer is the thread owning the ring, which appends whole lines, and the
+ * consumer is the writer of Log, which takes the bytes in place, in up to two parts
+ * as they wrap around. The indices only grow, and are masked into the buffer.
+ */
+class LogRing {
+public:
+    /**
+     * @brief Constructor for LogRing.
+     * @param capacity The size of the buffer, a power of two.
+     */
+    explicit LogRing(size_t capacity) : buf_(new char[capacity]), mask_(capacity - 1),
+                                        head_(0), tail_(0), closed_(false) {
+        assert(capacity > 0 && (capacity & mask_) == 0);
+    }
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    /**
+     * @brief Append the bytes, called by the producer only.
+     * @return False if they do not fit until the consumer takes some.
+     */
+    bool push(const char* data, size_t len) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if(len > mask_ + 1 - (head - tail_.load(std::memory_order_acquire)))
+            return false;
+        size_t pos = head & mask_;
+        size_t first = std::min(len, mask_ + 1 - pos);
+        memcpy(&buf_[pos], data, first);
+        memcpy(&buf_[0], data + first, len - first);
+        head_.store(head + len, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Get the bytes appended, called by the consumer only.
+     * @param second Set to the part wrapped around to the start of the buffer.
+     * @return The part from the oldest byte to the end of the buffer at most.
+     */
+    std::pair<const char*, size_t> peek(std::pair<const char*, size_t>& second) const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t len = head_.load(std::memory_order_acquire) - tail;
+        size_t pos = tail & mask_;
+        size_t first = std::min(len, mask_ + 1 - pos);
+        second = { &buf_[0], len - first };
+        return { &buf_[pos], first };
+    }
+
+    /**
+     * @brief Free the bytes written, called by the consumer only.
+     */
+    void pop(size_t len) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Mark the ring as left by its producer, which exited.
+     */
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    std::unique_ptr<char[]> buf_;
+    const size_t mask_;
+    alignas(64) std::atomic<size_t> head_;  // Advanced by the producer
+    alignas(64) std::atomic<size_t> tail_;  // Advanced by the consumer
+    std::atomic<bool> closed_;
+};
+
+#endif //LOG_RING_H
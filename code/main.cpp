@@ -7,16 +7,29 @@
  */
 
 #include <unistd.h>
+#include <stdio.h>
 #include "server/webserver.h"
 
-int main() {
+int main(int argc, char* argv[]) {
+    /* 用户存储: 默认MySQL, -u 文件 用SQLite文件, -u "" 仅内存 */
+    const char* userFile = nullptr;
+    int opt;
+    while((opt = getopt(argc, argv, "u:")) != -1) {
+        if(opt != 'u') {
+            fprintf(stderr, "Usage: %s [-u user_file]\n", argv[0]);
+            return 1;
+        }
+        userFile = optarg;
+    }
+
     /* 守护进程 后台运行 */
     //daemon(1, 0); 
 
     WebServer server(
         1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
         3306, "root", "server1956.", "serverdb", /* Mysql配置 */
-        12, 6, true, 0, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        12, 6, true, 0, 1024,              /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        userFile);                         /* 内嵌用户存储: nullptr用MySQL, ""仅内存, 否则为SQLite文件路径 */
     server.start();
 } 
   
\ No newline at end of file
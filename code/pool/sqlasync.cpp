@@ -0,0 +1,403 @@
+/*
+ * @file        : sqlasync.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include <mysql/mysqld_error.h>
+#include "sqlasync.h"
+
+SqlAsync* SqlAsync::Instance() {
+    static SqlAsync sqlAsync;
+    return &sqlAsync;
+}
+
+SqlAsync::SqlAsync() : wakeupFd_(-1), port_(0), opened_(false) {}
+
+SqlAsync::~SqlAsync() {
+    close();
+}
+
+int SqlAsync::fd() const {
+    return opened_ ? epoller_.GetFd() : -1;
+}
+
+void SqlAsync::query(std::string query, std::vector<std::string> params, Callback callback) {
+    Task task;
+    task.query = std::move(query);
+    task.params = std::move(params);
+    task.callback = std::move(callback);
+    task.queued = Clock::now();
+    {
+        // Checked under the lock, so the wakeup is not written after close has closed it.
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(opened_) {
+            pending_.push_back(std::move(task));
+            uint64_t one = 1;
+            write(wakeupFd_, &one, sizeof(one));
+            return;
+        }
+    }
+    Result result;
+    result.errnum = CR_SERVER_GONE_ERROR;
+    task.callback(result);
+}
+
+void SqlAsync::unwatch_(Conn& conn) {
+    if(conn.fd < 0)
+        return;
+    epoller_.DelFd(conn.fd);
+    fdConn_.erase(conn.fd);
+    conn.fd = -1;
+}
+
+void SqlAsync::close() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        opened_ = false;
+    }
+    for(auto& conn: conns_) {
+        unwatch_(conn);
+        if(conn.sql)
+            mysql_close(conn.sql);
+        conn.stmts.clear();
+    }
+    conns_.clear();
+    if(wakeupFd_ >= 0) {
+        ::close(wakeupFd_);
+        wakeupFd_ = -1;
+    }
+}
+
+// The nonblocking API (MYSQL_OPT_NONBLOCK and mysql_*_start/_cont) is of MariaDB Connector/C only.
+#ifdef MARIADB_BASE_VERSION
+
+bool SqlAsync::init(const char* host, int port, const char* user, const char* pwd,
+                    const char* dbName, int connSize) {
+    assert(connSize > 0);
+    host_ = host;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    port_ = port;
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(wakeupFd_ < 0 || !epoller_.AddFd(wakeupFd_, EPOLLIN)) {
+        LOG_ERROR("SqlAsync init error: %s", strerror(errno));
+        return false;
+    }
+    conns_.resize(connSize);
+    int connected = 0;
+    // Connect in blocking mode at start, like SqlConnPool, the connections lost are connected again by connect_.
+    for(auto& conn: conns_) {
+        conn.sql = open_();
+        if(conn.sql && mysql_real_connect(conn.sql, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                                          dbName_.c_str(), port_, nullptr, 0)) {
+            conn.state = IDLE;
+            connected++;
+            continue;
+        }
+        LOG_ERROR("MySql Connect error: %s", conn.sql ? mysql_error(conn.sql) : "init error");
+        conn.state = BROKEN;
+        conn.timed = true;
+        conn.deadline = Clock::now() + MS(RECONNECT_DELAY_MS);
+    }
+    if(connected == 0) {
+        close();
+        return false;
+    }
+    opened_ = true;
+    LOG_INFO("SqlAsync connected %d of %d connections", connected, connSize);
+    return true;
+}
+
+MYSQL* SqlAsync::open_() {
+    MYSQL* sql = mysql_init(nullptr);
+    if(!sql)
+        return nullptr;
+    unsigned int timeout = TIMEOUT_S;
+    mysql_options(sql, MYSQL_OPT_NONBLOCK, 0);
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    mysql_options(sql, MYSQL_OPT_READ_TIMEOUT, &timeout);
+    mysql_options(sql, MYSQL_OPT_WRITE_TIMEOUT, &timeout);
+    return sql;
+}
+
+void SqlAsync::handleEvents() {
+    int eventCnt = epoller_.Wait(0);
+    for(int i = 0; i < eventCnt; i++) {
+        int fd = epoller_.GetEventFd(i);
+        uint32_t events = epoller_.GetEvents(i);
+        if(fd == wakeupFd_) {
+            uint64_t count;
+            read(wakeupFd_, &count, sizeof(count));
+            continue;
+        }
+        auto it = fdConn_.find(fd);
+        if(it == fdConn_.end())
+            continue;   // Unwatched by an earlier event
+        int ready = 0;
+        if(events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            ready |= MYSQL_WAIT_READ;   // Reading reports the error
+        if(events & EPOLLOUT)
+            ready |= MYSQL_WAIT_WRITE;
+        if(events & EPOLLPRI)
+            ready |= MYSQL_WAIT_EXCEPT;
+        advance_(conns_[it->second], ready);
+    }
+    dispatch_();
+}
+
+int SqlAsync::handleTimeouts() {
+    int timeMS = -1;
+    bool fired = false;
+    for(auto& conn: conns_) {
+        if(!conn.timed)
+            continue;
+        if(conn.deadline <= Clock::now()) {
+            conn.timed = false;
+            fired = true;
+            if(conn.state == BROKEN)
+                connect_(conn);
+            else
+                advance_(conn, MYSQL_WAIT_TIMEOUT);
+        }
+        if(conn.timed) {
+            int remainMS = std::chrono::duration_cast<MS>(conn.deadline - Clock::now()).count();
+            remainMS = remainMS > 0 ? remainMS : 0;
+            if(timeMS < 0 || remainMS < timeMS)
+                timeMS = remainMS;
+        }
+    }
+    if(fired)
+        dispatch_();
+    int queueMS = expire_();
+    if(queueMS >= 0 && (timeMS < 0 || queueMS < timeMS))
+        timeMS = queueMS;
+    return timeMS;
+}
+
+void SqlAsync::connect_(Conn& conn) {
+    unwatch_(conn);
+    if(conn.sql)
+        mysql_close(conn.sql);
+    conn.stmts.clear();     // Closed after the connection, so they are freed without a round trip
+    conn.sql = open_();
+    if(!conn.sql) {
+        LOG_ERROR("MySql init error!");
+        conn.state = BROKEN;
+        conn.timed = true;
+        conn.deadline = Clock::now() + MS(RECONNECT_DELAY_MS);
+        return;
+    }
+    conn.state = CONNECTING;
+    advance_(conn, 0);
+}
+
+void SqlAsync::advance_(Conn& conn, int ready) {
+    int status = 0;
+    switch(conn.state) {
+    case CONNECTING: {
+        MYSQL* ret = nullptr;
+        status = ready ? mysql_real_connect_cont(&ret, conn.sql, ready)
+                       : mysql_real_connect_start(&ret, conn.sql, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                                                  dbName_.c_str(), port_, nullptr, 0);
+        if(status)
+            break;
+        unwatch_(conn);
+        conn.timed = false;
+        if(!ret) {
+            LOG_ERROR("MySql Connect error: %s", mysql_error(conn.sql));
+            conn.state = BROKEN;
+            conn.timed = true;
+            conn.deadline = Clock::now() + MS(RECONNECT_DELAY_MS);
+            return;
+        }
+        LOG_INFO("MySql connected again");
+        conn.state = IDLE;
+        return;
+    }
+    case PREPARING: {
+        int ret = 0;
+        status = ready ? mysql_stmt_prepare_cont(&ret, conn.stmt->get(), ready)
+                       : mysql_stmt_prepare_start(&ret, conn.stmt->get(), conn.task.query.data(), conn.task.query.size());
+        if(status)
+            break;
+        if(ret) {
+            fail_(conn);
+            return;
+        }
+        conn.state = EXECUTING;
+        ready = 0;
+    }
+    [[fallthrough]];
+    case EXECUTING: {
+        int ret = 0;
+        if(!ready && !conn.stmt->bindParams(conn.task.params)) {
+            fail_(conn);
+            return;
+        }
+        status = ready ? mysql_stmt_execute_cont(&ret, conn.stmt->get(), ready)
+                       : mysql_stmt_execute_start(&ret, conn.stmt->get());
+        if(status)
+            break;
+        if(ret) {
+            fail_(conn);
+            return;
+        }
+        conn.state = STORING;
+        ready = 0;
+    }
+    [[fallthrough]];
+    case STORING: {
+        int ret = 0;
+        status = ready ? mysql_stmt_store_result_cont(&ret, conn.stmt->get(), ready)
+                       : mysql_stmt_store_result_start(&ret, conn.stmt->get());
+        if(status)
+            break;
+        if(ret) {
+            fail_(conn);
+            return;
+        }
+        // The rows are all stored, so fetching them does not block.
+        Result result;
+        result.ok = true;
+        conn.stmt->fetchRows(result);
+        finish_(conn, result);
+        return;
+    }
+    default:
+        return;
+    }
+    wait_(conn, status);
+}
+
+void SqlAsync::wait_(Conn& conn, int status) {
+    int sock = mysql_get_socket(conn.sql);
+    uint32_t events = 0;
+    if(status & MYSQL_WAIT_READ)
+        events |= EPOLLIN;
+    if(status & MYSQL_WAIT_WRITE)
+        events |= EPOLLOUT;
+    if(status & MYSQL_WAIT_EXCEPT)
+        events |= EPOLLPRI;
+    if(conn.fd != sock) {
+        unwatch_(conn);
+        if(epoller_.AddFd(sock, events)) {
+            conn.fd = sock;
+            fdConn_[sock] = &conn - conns_.data();
+        }
+    }
+    else {
+        epoller_.ModFd(sock, events);
+    }
+    conn.timed = status & MYSQL_WAIT_TIMEOUT;
+    if(conn.timed)
+        conn.deadline = Clock::now() + MS(mysql_get_timeout_value_ms(conn.sql));
+}
+
+void SqlAsync::fail_(Conn& conn) {
+    Result result;
+    result.errnum = mysql_stmt_errno(conn.stmt->get());
+    LOG_DEBUG("Query error: %s", mysql_stmt_error(conn.stmt->get()));
+    if(conn.state == PREPARING || result.errnum == ER_UNKNOWN_STMT_HANDLER)
+        conn.stmts.erase(conn.task.query);  // Prepared again by the next query
+    conn.stmt = nullptr;
+    finish_(conn, result);
+}
+
+void SqlAsync::finish_(Conn& conn, Result& result) {
+    unwatch_(conn);
+    conn.timed = false;
+    conn.state = IDLE;
+    conn.stmt = nullptr;
+    Task task = std::move(conn.task);
+    conn.task = Task();
+    if(result.errnum == CR_SERVER_GONE_ERROR || result.errnum == CR_SERVER_LOST) {
+        LOG_WARN("MySql connection lost, connecting again");
+        connect_(conn);
+    }
+    if(SqlStmt::isLost(result.errnum) && !task.retried) {
+        // Run it once more, its statement is prepared again on the connection it runs.
+        task.retried = true;
+        task.queued = Clock::now();     // Queued again, not to expire for the time it has run
+        std::lock_guard<std::mutex> locker(mtx_);
+        pending_.push_front(std::move(task));
+        return;
+    }
+    if(task.callback)
+        task.callback(result);
+}
+
+void SqlAsync::dispatch_() {
+    bool started = true;
+    // A query may finish at once and leave its connection idle for the next one.
+    while(started) {
+        started = false;
+        for(auto& conn: conns_) {
+            if(conn.state != IDLE)
+                continue;
+            {
+                std::lock_guard<std::mutex> locker(mtx_);
+                if(pending_.empty())
+                    return;
+                conn.task = std::move(pending_.front());
+                pending_.pop_front();
+            }
+            std::unique_ptr<SqlStmt>& stmt = conn.stmts[conn.task.query];
+            conn.state = stmt ? EXECUTING : PREPARING;
+            if(!stmt)
+                stmt.reset(new SqlStmt(conn.sql));
+            conn.stmt = stmt.get();
+            advance_(conn, 0);
+            started = true;
+        }
+    }
+}
+
+int SqlAsync::expire_() {
+    std::vector<Task> expired;
+    int timeMS = -1;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        TimeStamp now = Clock::now();
+        // Dispatched in order, so after the tasks run again at the front, the first one was queued first.
+        for(auto it = pending_.begin(); it != pending_.end(); ) {
+            TimeStamp deadline = it->queued + std::chrono::seconds(TIMEOUT_S);
+            if(deadline <= now) {
+                expired.push_back(std::move(*it));
+                it = pending_.erase(it);
+                continue;
+            }
+            int remainMS = std::chrono::duration_cast<MS>(deadline - now).count();
+            if(timeMS < 0 || remainMS < timeMS)
+                timeMS = remainMS;
+            if(!it->retried)
+                break;
+            ++it;
+        }
+    }
+    if(!expired.empty())
+        LOG_WARN("SqlAsync: %zu queries not started in %u s", expired.size(), TIMEOUT_S);
+    for(auto& task: expired) {
+        Result result;
+        result.errnum = CR_SERVER_GONE_ERROR;
+        task.callback(result);
+    }
+    return timeMS;
+}
+
+#else
+
+bool SqlAsync::init(const char*, int, const char*, const char*, const char*, int) {
+    LOG_WARN("SqlAsync needs the nonblocking API of MariaDB Connector/C, the queries run on SqlConnPool");
+    return false;
+}
+
+void SqlAsync::handleEvents() {}
+
+int SqlAsync::handleTimeouts() {
+    return -1;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * @file        : sqlasync.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the SqlAsync class, which is designed for
+ *                running queries on a few MySQL connections without blocking any thread. It uses
+ *                the nonblocking API of MariaDB Connector/C (mysql_real_query_start/_cont), and the
+ *                queries advance when their sockets become ready in the event loop of the server.
+ */
+
+#ifndef SQLASYNC_H
+#define SQLASYNC_H
+
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <memory>
+#include "sqlstmt.h"
+#include "../server/epoller.h"
+#include "../utils/timer/timer.h"
+#include "../log/log.h"
+
+/**
+ * @class SqlAsync
+ * @brief The SqlAsync class is used to run queries on nonblocking MySQL connections.
+ *
+ * The queries are queued from any thread and each one runs on the first idle connection,
+ * as a prepared statement which the connection keeps for the next queries of the same SQL.
+ * The sockets of the connections are watched by an epoll File Descriptor of the class,
+ * which is expected to be polled by the event loop of the server, so a few connections
+ * serve any number of requests waiting for the database without a thread for each one.
+ * A connection lost is connected again in the background, and its query is run once more
+ * on the next connection with the statement prepared again. Built against a client library
+ * without the nonblocking API, such as the libmysqlclient of MySQL, init fails and the
+ * callers run the queries on SqlConnPool instead.
+ */
+class SqlAsync {
+public:
+    using Result = SqlResult;
+
+    /**
+     * @brief Type definition for the callbacks of queries, called in the event loop.
+     */
+    using Callback = std::function<void(const Result&)>;
+
+    static SqlAsync* Instance();
+
+    /**
+     * @brief Connect to the database.
+     * @param connSize The number of connections.
+     * @return A flag whether any connection succeeds, false without the nonblocking API.
+     */
+    bool init(const char* host, int port, const char* user, const char* pwd,
+              const char* dbName, int connSize);
+
+    /**
+     * @brief Get the epoll File Descriptor watching the connections (-1 if not initialized or closed).
+     */
+    int fd() const;
+
+    /**
+     * @brief Queue the query, it is thread-safe.
+     * @param query The SQL statement, with '?' for the parameters.
+     * @param params The values of the parameters, bound as strings.
+     * @param callback Called with the result in the event loop, it should not block.
+     */
+    void query(std::string query, std::vector<std::string> params, Callback callback);
+
+    /**
+     * @brief Advance the queries whose sockets are ready and start the queued queries.
+     */
+    void handleEvents();
+
+    /**
+     * @brief Advance the queries timed out, fail the queued ones waiting longer than the
+     * timeout and connect again the connections lost.
+     * @return The time to the next timeout in milliseconds, -1 if none.
+     */
+    int handleTimeouts();
+
+    void close();
+
+private:
+    enum CONN_STATE {
+        IDLE,
+        CONNECTING,
+        PREPARING,
+        EXECUTING,
+        STORING,
+        BROKEN,     // Waiting to connect again
+    };
+
+    struct Task {
+        std::string query;
+        std::vector<std::string> params;
+        Callback callback;
+        bool retried = false;       // Whether it has been run again for a connection lost
+        TimeStamp queued;           // When it was queued (again), it fails if not started within TIMEOUT_S
+    };
+
+    struct Conn {
+        MYSQL* sql = nullptr;
+        CONN_STATE state = BROKEN;
+        int fd = -1;                // The socket watched, -1 if not watched
+        bool timed = false;         // Whether the deadline is set
+        TimeStamp deadline;
+        Task task;
+        SqlStmt* stmt = nullptr;    // The statement of the task
+        std::unordered_map<std::string, std::unique_ptr<SqlStmt>> stmts;   // Prepared statements by the query
+    };
+
+    SqlAsync();
+    ~SqlAsync();
+
+    /**
+     * @brief Create a handle in nonblocking mode with the timeouts set.
+     * @return The handle, nullptr if out of memory.
+     */
+    static MYSQL* open_();
+
+    /**
+     * @brief Start connecting the connection, with the socket watched.
+     */
+    void connect_(Conn& conn);
+
+    /**
+     * @brief Advance the operation of the connection until it waits or finishes.
+     * @param ready The MYSQL_WAIT_* status ready, 0 to start the operation of the state.
+     */
+    void advance_(Conn& conn, int ready);
+
+    /**
+     * @brief Wait for the MYSQL_WAIT_* status returned by the operation.
+     */
+    void wait_(Conn& conn, int status);
+
+    /**
+     * @brief Stop watching the socket of the connection.
+     */
+    void unwatch_(Conn& conn);
+
+    /**
+     * @brief Fail the query of the connection with the error of its statement.
+     */
+    void fail_(Conn& conn);
+
+    /**
+     * @brief Finish the query of the connection and call its callback.
+     */
+    void finish_(Conn& conn, Result& result);
+
+    /**
+     * @brief Start the queued queries on the idle connections.
+     */
+    void dispatch_();
+
+    /**
+     * @brief Fail the queued queries waiting longer than the timeout with CR_SERVER_GONE_ERROR.
+     * @return The time to the timeout of the oldest one left in milliseconds, -1 if none.
+     */
+    int expire_();
+
+    static const unsigned int TIMEOUT_S = 5;        // Timeout of connecting, reading and writing
+    static const int RECONNECT_DELAY_MS = 1000;     // Delay before connecting a lost connection again
+
+    Epoller epoller_;
+    int wakeupFd_;  // To wake up the event loop when a query is queued
+    std::vector<Conn> conns_;
+    std::unordered_map<int, size_t> fdConn_;    // Map the watched socket to the connection.
+    std::string host_, user_, pwd_, dbName_;
+    int port_;
+
+    std::atomic<bool> opened_;  // Whether init succeeded and close is not called, set under mtx_
+    std::deque<Task> pending_;  // In the order queued, a task run again is put back at the front
+    std::mutex mtx_;
+};
+
+#endif //SQLASYNC_H
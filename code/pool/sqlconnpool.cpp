@@ -6,6 +6,7 @@
  * Description  : 
  */
 
+#include <algorithm>
 #include "sqlconnpool.h"
 
 SqlConnPool* SqlConnPool::Instance() {
@@ -13,57 +14,416 @@ SqlConnPool* SqlConnPool::Instance() {
     return &connPool;
 }
 
+thread_local int SqlConnPool::homeSlot_ = -1;
+
+SqlConnPool::SqlConnPool() : port_(0), maxSize_(0), minSize_(0), acquireTimeoutMS_(0), 
+                             closed_(false), affine_(false), slotCount_(0), waiters_(0), 
+                             shrinkAtMS_(0), open_(0), waits_(), timeouts_(0) {}
+
 void SqlConnPool::Init(const char* host, int port,
             const char* user,const char* pwd, const char* dbName,
-            int connSize = 10) {
-    // assert(connSize > 0);
-    for (int i = 0; i < connSize; i++) {
-        MYSQL * init_sql = mysql_init(nullptr);
-        if (!init_sql) {
-            LOG_ERROR("MySql init error!");
-            // assert(init_sql);
+            int maxSize, int minSize, int acquireTimeoutMS, bool affine) {
+    assert(maxSize > 0 && minSize >= 0);
+    host_ = host;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    port_ = port;
+    maxSize_ = maxSize;
+    minSize_ = std::min(minSize, maxSize);
+    acquireTimeoutMS_ = acquireTimeoutMS;
+    affine_ = affine;
+    if (affine_) {
+        slots_.reset(new Slot[maxSize_]);
+        slotCount_ = maxSize_;
+    }
+    // Not thread-safe, so it is called before connecting in parallel.
+    mysql_library_init(0, nullptr, nullptr);
+
+    std::vector<MYSQL*> conns(minSize_, nullptr);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < minSize_; i++) {
+        threads.emplace_back([this, &conns, i]() { conns[i] = Connect_(); });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    for (MYSQL* sql: conns) {
+        // The failed ones are opened again on demand.
+        if (sql) {
+            idle_.push_back({ sql, Clock::now() });
+            open_++;
         }
-        MYSQL * sql = mysql_real_connect(init_sql, host,
-                                 user, pwd,
-                                 dbName, port, nullptr, 0);
-        if (!sql) {
-            LOG_ERROR("MySql Connect error!");
-            std::cout << mysql_error(init_sql) << std::endl;
-            // assert(sql);
+    }
+    LOG_INFO("SqlConnPool opened %d of %d connections, max %d%s", open_, minSize_, maxSize_, affine_ ? ", affine" : "");
+}
+
+MYSQL* SqlConnPool::Connect_() {
+    MYSQL * init_sql = mysql_init(nullptr);
+    if (!init_sql) {
+        LOG_ERROR("MySql init error!");
+        return nullptr;
+    }
+    // mysql_ping connects again a connection lost, see GetConn and Execute.
+    my_bool reconnect = 1;
+    unsigned int timeout = CONNECT_TIMEOUT_S;
+    mysql_options(init_sql, MYSQL_OPT_RECONNECT, &reconnect);
+    mysql_options(init_sql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    MYSQL * sql = mysql_real_connect(init_sql, host_.c_str(),
+                                     user_.c_str(), pwd_.c_str(),
+                                     dbName_.c_str(), port_, nullptr, 0);
+    if (!sql) {
+        LOG_ERROR("MySql Connect error: %s", mysql_error(init_sql));
+        mysql_close(init_sql);
+    }
+    return sql;
+}
+
+void SqlConnPool::Close_(MYSQL* sql) {
+    // Taken out before the connection is freed, when its address may be reused by a new one.
+    std::unordered_map<std::string, std::unique_ptr<SqlStmt>> stmts;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        auto it = stmts_.find(sql);
+        if (it != stmts_.end()) {
+            stmts.swap(it->second);
+            stmts_.erase(it);
         }
-        connQue_.push(sql);
     }
-    sem_init(&semId_, 0, connSize);
+    mysql_close(sql);
+    // The statements are closed when they leave the scope, after the connection, so they
+    // are freed without a round trip.
 }
 
 MYSQL* SqlConnPool::GetConn() {
+    return affine_ ? GetLeased_() : GetShared_();
+}
+
+void SqlConnPool::FreeConn(MYSQL* sql) {
+    if (affine_)
+        FreeLeased_(sql);
+    else
+        FreeShared_(sql);
+}
+
+MYSQL* SqlConnPool::GetShared_() {
+    TimeStamp start = Clock::now();
+    TimeStamp deadline = start + MS(acquireTimeoutMS_);
     MYSQL *sql = nullptr;
-    if(connQue_.empty()){
-        LOG_WARN("SqlConnPool busy!");
-        return nullptr;
+    while (!sql) {
+        bool idle = false;
+        {
+            std::unique_lock<std::mutex> locker(mtx_);
+            while (!closed_ && idle_.empty() && open_ >= maxSize_) {
+                if (cond_.wait_until(locker, deadline) == std::cv_status::timeout && idle_.empty() && open_ >= maxSize_) {
+                    timeouts_++;
+                    LOG_WARN("SqlConnPool busy!");
+                    return nullptr;
+                }
+            }
+            if (closed_)
+                return nullptr;
+            if (!idle_.empty()) {
+                // The most recent one, the others may become idle long enough to be closed.
+                sql = idle_.back().sql;
+                idle = Clock::now() - idle_.back().since >= MS(VALIDATE_IDLE_MS);
+                idle_.pop_back();
+            }
+            else {
+                open_++;    // Reserved before connecting out of the lock
+            }
+        }
+        if (sql && idle && mysql_ping(sql)) {
+            LOG_WARN("MySql connection lost: %s", mysql_error(sql));
+            Close_(sql);
+            sql = nullptr;
+            std::lock_guard<std::mutex> locker(mtx_);
+            open_--;
+            continue;
+        }
+        if (!sql && !(sql = Connect_())) {
+            {
+                std::lock_guard<std::mutex> locker(mtx_);
+                open_--;
+            }
+            cond_.notify_one();
+            return nullptr;
+        }
     }
-    sem_wait(&semId_);
+    CountWait_(start);
+    return sql;
+}
+
+void SqlConnPool::CountWait_(TimeStamp start) {
+    int waitMS = std::chrono::duration_cast<MS>(Clock::now() - start).count();
+    size_t bucket = 0;
+    while (bucket < WAIT_BUCKETS - 1 && waitMS >= WAIT_BOUNDS_MS[bucket])
+        bucket++;
+    waits_[bucket]++;
+}
+
+void SqlConnPool::FreeShared_(MYSQL* sql) {
+    // assert(sql);
+    std::vector<MYSQL*> expired;
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        sql = connQue_.front();
-        connQue_.pop();
+        if (closed_) {
+            expired.push_back(sql);
+            open_--;
+        }
+        else {
+            idle_.push_back({ sql, Clock::now() });
+        }
+        // Shrink from the longest idle ones.
+        TimeStamp now = Clock::now();
+        while (!idle_.empty() && open_ > minSize_ && now - idle_.front().since >= MS(SHRINK_IDLE_MS)) {
+            expired.push_back(idle_.front().sql);
+            idle_.pop_front();
+            open_--;
+        }
+    }
+    cond_.notify_one();
+    for (MYSQL* item: expired) {
+        Close_(item);
     }
+}
+
+MYSQL* SqlConnPool::GetLeased_() {
+    TimeStamp start = Clock::now();
+    TimeStamp deadline = start + MS(acquireTimeoutMS_);
+    // The slot of the thread is free unless the thread holds two connections.
+    MYSQL* sql = homeSlot_ >= 0 ? TakeSlot_(homeSlot_) : nullptr;
+    while (!sql && !closed_) {
+        if ((sql = StealSlot_()))
+            break;
+        int slot = ClaimEmptySlot_();
+        if (slot >= 0) {
+            // Fill it from the pool.
+            if (!(sql = GetShared_())) {
+                slots_[slot].state = EMPTY;
+                NotifyWaiter_();    // Another thread may fill it in time
+                return nullptr;
+            }
+            slots_[slot].sql = sql;
+            homeSlot_ = slot;
+            break;
+        }
+        std::unique_lock<std::mutex> locker(mtx_);
+        waiters_++;
+        // The slot is taken out of the lock, as validating its connection may close it.
+        bool ready = cond_.wait_until(locker, deadline, [this]() { return closed_ || HasSlot_(); });
+        waiters_--;
+        if (!ready) {
+            timeouts_++;
+            LOG_WARN("SqlConnPool busy!");
+            return nullptr;
+        }
+    }
+    if (!sql)
+        return nullptr;
+    CountWait_(start);
     return sql;
 }
 
-void SqlConnPool::FreeConn(MYSQL* sql) {
-    // assert(sql);
+int SqlConnPool::ClaimEmptySlot_() {
+    for (int i = 0; i < slotCount_; i++) {
+        int expected = EMPTY;
+        if (slots_[i].state.compare_exchange_strong(expected, BUSY))
+            return i;
+    }
+    return -1;
+}
+
+bool SqlConnPool::HasSlot_() const {
+    for (int i = 0; i < slotCount_; i++) {
+        if (slots_[i].state != BUSY)
+            return true;
+    }
+    return false;
+}
+
+MYSQL* SqlConnPool::TakeSlot_(int slot) {
+    int expected = FREE;
+    if (!slots_[slot].state.compare_exchange_strong(expected, BUSY))
+        return nullptr;
+    MYSQL* sql = slots_[slot].sql;
+    if (Clock::now() - slots_[slot].since >= MS(VALIDATE_IDLE_MS) && mysql_ping(sql)) {
+        LOG_WARN("MySql connection lost: %s", mysql_error(sql));
+        Close_(sql);
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            open_--;
+        }
+        slots_[slot].sql = nullptr;
+        slots_[slot].state = EMPTY;     // Filled again from the pool
+        NotifyWaiter_();
+        return nullptr;
+    }
+    return sql;
+}
+
+MYSQL* SqlConnPool::StealSlot_() {
+    int first = homeSlot_ >= 0 ? homeSlot_ + 1 : 0;
+    for (int i = 0; i < slotCount_; i++) {
+        int slot = (first + i) % slotCount_;
+        MYSQL* sql = TakeSlot_(slot);
+        if (sql) {
+            homeSlot_ = slot;   // The thread keeps it from now on
+            return sql;
+        }
+    }
+    return nullptr;
+}
+
+void SqlConnPool::FreeLeased_(MYSQL* sql) {
+    int slot = homeSlot_;
+    if (slot < 0 || slots_[slot].sql != sql) {
+        // Freed by a thread holding two connections.
+        for (slot = 0; slot < slotCount_ && slots_[slot].sql != sql; slot++);
+        assert(slot < slotCount_);
+    }
+    if (closed_) {
+        Close_(sql);
+        slots_[slot].sql = nullptr;
+        slots_[slot].state = EMPTY;
+        std::lock_guard<std::mutex> locker(mtx_);
+        open_--;
+        return;
+    }
+    slots_[slot].since = Clock::now();
+    slots_[slot].state = FREE;
+    NotifyWaiter_();
+    ShrinkSlots_();
+}
+
+void SqlConnPool::ShrinkSlots_() {
+    // One of the threads freeing their connections checks the slots, every half of SHRINK_IDLE_MS.
+    TimeStamp now = Clock::now();
+    long long nowMS = std::chrono::duration_cast<MS>(now.time_since_epoch()).count();
+    long long due = shrinkAtMS_;
+    if (nowMS < due || !shrinkAtMS_.compare_exchange_strong(due, nowMS + SHRINK_IDLE_MS / 2))
+        return;
+    for (int i = 0; i < slotCount_; i++) {
+        // Taken as a lender would, so the time it is freed is not written meanwhile.
+        int expected = FREE;
+        if (!slots_[i].state.compare_exchange_strong(expected, BUSY))
+            continue;
+        bool expired = false;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            // Closed as well once the pool is closed, which leaves the busy slots to their holders.
+            if (closed_ || (open_ > minSize_ && now - slots_[i].since >= MS(SHRINK_IDLE_MS))) {
+                open_--;
+                expired = true;
+            }
+        }
+        MYSQL* sql = expired ? slots_[i].sql.exchange(nullptr) : nullptr;
+        slots_[i].state = expired ? EMPTY : FREE;
+        NotifyWaiter_();
+        if (sql)
+            Close_(sql);
+    }
+}
+
+void SqlConnPool::NotifyWaiter_() {
+    if (waiters_ > 0) {
+        // Under the lock, so a waiter either sees the slot not busy or is waiting for the notice.
+        std::lock_guard<std::mutex> locker(mtx_);
+        cond_.notify_one();
+    }
+}
+
+int SqlConnPool::OpenCount() {
     std::lock_guard<std::mutex> locker(mtx_);
-    connQue_.push(sql);
-    sem_post(&semId_);
+    return open_;
 }
 
-void SqlConnPool::ClosePool() {
+int SqlConnPool::IdleCount() {
     std::lock_guard<std::mutex> locker(mtx_);
-    while(!connQue_.empty()) {
-        auto item = connQue_.front();
-        connQue_.pop();
-        mysql_close(item);
+    return idle_.size();
+}
+
+std::vector<size_t> SqlConnPool::WaitHistogram() const {
+    std::vector<size_t> histogram;
+    for (auto& count: waits_) {
+        histogram.push_back(count);
+    }
+    return histogram;
+}
+
+SqlStmt* SqlConnPool::GetStmt_(MYSQL* sql, const std::string& query, unsigned int* errnum) {
+    std::unordered_map<std::string, std::unique_ptr<SqlStmt>>* stmts;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        stmts = &stmts_[sql];
+    }
+    std::unique_ptr<SqlStmt>& stmt = (*stmts)[query];
+    if(stmt)
+        return stmt.get();
+    stmt.reset(new SqlStmt(sql));
+    if(!stmt->get() || mysql_stmt_prepare(stmt->get(), query.data(), query.size())) {
+        *errnum = stmt->get() ? mysql_stmt_errno(stmt->get()) : mysql_errno(sql);
+        LOG_ERROR("Prepare error: %s", stmt->get() ? mysql_stmt_error(stmt->get()) : mysql_error(sql));
+        stmts->erase(query);
+        return nullptr;
+    }
+    return stmt.get();
+}
+
+SqlResult SqlConnPool::Execute(MYSQL* sql, const std::string& query, const std::vector<std::string>& params) {
+    assert(sql);
+    SqlResult result;
+    for(int i = 0; i < 2; i++) {
+        SqlStmt* stmt = GetStmt_(sql, query, &result.errnum);
+        if(stmt) {
+            if(stmt->bindParams(params) && !mysql_stmt_execute(stmt->get()) && !mysql_stmt_store_result(stmt->get())) {
+                result.ok = true;
+                result.errnum = 0;
+                stmt->fetchRows(result);
+                return result;
+            }
+            result.errnum = mysql_stmt_errno(stmt->get());
+            LOG_DEBUG("Execute error: %s", mysql_stmt_error(stmt->get()));
+        }
+        if(!SqlStmt::isLost(result.errnum))
+            break;
+        // The statements are gone with the session, prepare them again on the new one.
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            stmts_.erase(sql);
+        }
+        if(mysql_ping(sql))
+            break;
+    }
+    return result;
+}
+
+void SqlConnPool::ClosePool() {
+    std::deque<Idle> idle;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        // Not initialized when the users are kept without MySQL, so the library is not ended either.
+        if (closed_ || maxSize_ == 0)
+            return;
+        closed_ = true;
+        idle.swap(idle_);
+        open_ -= idle.size();
+    }
+    for (int i = 0; i < slotCount_; i++) {
+        int expected = FREE;
+        if (slots_[i].state.compare_exchange_strong(expected, BUSY)) {
+            // The busy ones are closed when they are freed.
+            idle.push_back({ slots_[i].sql, slots_[i].since });
+            slots_[i].sql = nullptr;
+            slots_[i].state = EMPTY;
+            std::lock_guard<std::mutex> locker(mtx_);
+            open_--;
+        }
+    }
+    cond_.notify_all();
+    for (auto& item: idle) {
+        Close_(item.sql);
     }
     mysql_library_end();        
 }
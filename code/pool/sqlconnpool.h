@@ -12,42 +12,208 @@
 #include <mutex>
 #include <mysql/mysql.h>
 #include <string>
-#include <queue>
-#include <semaphore.h>
+#include <deque>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <sys/time.h>
 #include <iostream>
 #include <stdarg.h>           // vastart va_end
 #include <assert.h>
 #include <sys/stat.h> 
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "sqlstmt.h"
+#include "../utils/timer/timer.h"
 #include "../log/log.h"
 
+/**
+ * @class SqlConnPool
+ * @brief The SqlConnPool class is used to lend blocking MySQL connections to threads.
+ *
+ * The pool opens minSize connections in parallel at start and grows up to maxSize when
+ * every connection is lent, the connections idle for long are closed down to minSize. 
+ * A connection idle for a while is pinged before it is lent, which connects it again 
+ * if it is lost. A thread waits for a connection at most acquireTimeoutMS, and the 
+ * times waited are counted in a histogram.
+ *
+ * In affine mode each connection is leased to a slot instead, which a thread keeps
+ * as its own, so lending and freeing it are one atomic operation without the lock.
+ * A thread whose slot is busy takes over a free slot of another thread, and fills
+ * an empty slot from the pool, it only waits under the lock when every slot is busy.
+ * The slots free for SHRINK_IDLE_MS are emptied down to minSize connections, which
+ * is checked by the threads freeing their connections, once in a while.
+ */
 class SqlConnPool {
     friend class SqlConnRAII;
 public:
     static SqlConnPool *Instance();
 
+    /**
+     * @brief Connect to the database.
+     * @param maxSize The max number of connections.
+     * @param minSize The number of connections opened at start and kept when idle.
+     * @param acquireTimeoutMS The max time to wait for a connection.
+     * @param affine Whether to lease the connections to threads.
+     */
     void Init(const char* host, int port,
               const char* user,const char* pwd, 
-              const char* dbName, int connSize);
+              const char* dbName, int maxSize,
+              int minSize, int acquireTimeoutMS, bool affine);
     void ClosePool();
 
+    /**
+     * @brief Execute the query as a prepared statement on the connection.
+     * The statements are prepared once for each connection and prepared again when the
+     * connection is lost, which is connected again and the query is run once more.
+     * @param sql The connection from the pool.
+     * @param query The SQL statement, with '?' for the parameters.
+     * @param params The values of the parameters, bound as strings.
+     * @return The result of the query.
+     */
+    SqlResult Execute(MYSQL* sql, const std::string& query, const std::vector<std::string>& params);
+
+    int OpenCount();
+    int IdleCount();
+
+    // Upper bounds in milliseconds of the buckets of the wait histogram, the last bucket is unbounded.
+    static constexpr int WAIT_BOUNDS_MS[] = { 1, 10, 100, 1000 };
+    static const size_t WAIT_BUCKETS = sizeof(WAIT_BOUNDS_MS) / sizeof(WAIT_BOUNDS_MS[0]) + 1;
+
+    /**
+     * @brief Get the number of acquires in each bucket of the time waited.
+     */
+    std::vector<size_t> WaitHistogram() const;
+    size_t TimeoutCount() const { return timeouts_; }
+
 private:
-    SqlConnPool() = default;
+    SqlConnPool();
     ~SqlConnPool();
 
+    /**
+     * @brief Lend a connection, waiting for one at most acquireTimeoutMS.
+     * @return The connection, nullptr if none is available in time.
+     */
     MYSQL *GetConn();
 
     void FreeConn(MYSQL * conn);
 
-    std::queue<MYSQL *> connQue_;
+    /**
+     * @brief Lend a connection from the idle ones, or open one, see GetConn.
+     */
+    MYSQL *GetShared_();
+
+    void FreeShared_(MYSQL * conn);
+
+    /**
+     * @brief Lend the connection of the slot of the thread, or of another slot, see GetConn.
+     */
+    MYSQL *GetLeased_();
+
+    void FreeLeased_(MYSQL * conn);
+
+    /**
+     * @brief Take the slot if it is free, validating its connection.
+     * @return The connection, nullptr if the slot is not free or has lost its connection.
+     */
+    MYSQL* TakeSlot_(int slot);
+
+    /**
+     * @brief Take a free slot, starting from the one after the slot of the thread.
+     * @return The connection, nullptr if no slot is free.
+     */
+    MYSQL* StealSlot_();
+
+    /**
+     * @brief Take an empty slot to fill it.
+     * @return The slot, -1 if no slot is empty.
+     */
+    int ClaimEmptySlot_();
+
+    /**
+     * @brief Whether any slot is free or empty.
+     */
+    bool HasSlot_() const;
+
+    /**
+     * @brief Wake a thread waiting for a slot, after a slot becomes free or empty.
+     */
+    void NotifyWaiter_();
+
+    /**
+     * @brief Close the connections of the slots idle for long beyond minSize, if it is
+     * time to check them.
+     */
+    void ShrinkSlots_();
+
+    /**
+     * @brief Count the time waited for a connection in the histogram.
+     */
+    void CountWait_(TimeStamp start);
+
+    /**
+     * @brief Open a connection (blocking).
+     * @return The connection, nullptr if it fails.
+     */
+    MYSQL* Connect_();
+
+    /**
+     * @brief Close a connection with its statements.
+     */
+    void Close_(MYSQL* sql);
+
+    /**
+     * @brief Get the statement of the query prepared on the connection, preparing it if needed.
+     * @return The statement, nullptr if it fails to prepare.
+     */
+    SqlStmt* GetStmt_(MYSQL* sql, const std::string& query, unsigned int* errnum);
+
+    struct Idle {
+        MYSQL* sql;
+        TimeStamp since;
+    };
+
+    enum SLOT_STATE {
+        EMPTY,  // Without a connection
+        FREE,
+        BUSY,   // Lent or being filled, the connection is only accessed by the holder
+    };
+
+    struct Slot {
+        std::atomic<int> state{EMPTY};
+        std::atomic<MYSQL*> sql{nullptr};   // Set by the holder, read by the threads looking for their connection
+        TimeStamp since;    // When the connection is freed
+    };
+
+    static const int VALIDATE_IDLE_MS = 30000;  // Idle time after which a connection is pinged before lent
+    static const int SHRINK_IDLE_MS = 60000;    // Idle time after which a connection beyond minSize is closed
+    static const unsigned int CONNECT_TIMEOUT_S = 5;
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_;
+    int maxSize_;
+    int minSize_;
+    int acquireTimeoutMS_;
+    std::atomic<bool> closed_;
+    bool affine_;
+
+    std::unique_ptr<Slot[]> slots_;     // maxSize slots in affine mode
+    int slotCount_;
+    std::atomic<int> waiters_;          // Threads waiting for a free slot
+    static thread_local int homeSlot_;  // The slot of the thread, -1 if none
+    std::atomic<long long> shrinkAtMS_; // When the slots are checked for ShrinkSlots_ next
+
+    std::deque<Idle> idle_;     // The most recently freed connection at the back
+    int open_;                  // Connections open or opening, idle or lent
+    // Prepared statements of each connection by the query, only used by the holder of the connection.
+    std::unordered_map<MYSQL*, std::unordered_map<std::string, std::unique_ptr<SqlStmt>>> stmts_;
     std::mutex mtx_;
-    sem_t semId_;
+    std::condition_variable cond_;
 
-    // int MAX_CONN_;
-    // int useCount_;
-    // int freeCount_;
+    std::atomic<size_t> waits_[WAIT_BUCKETS];
+    std::atomic<size_t> timeouts_;
 };
 
 
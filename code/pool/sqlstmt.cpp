@@ -0,0 +1,72 @@
+/*
+ * @file        : sqlstmt.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include "sqlstmt.h"
+
+SqlStmt::~SqlStmt() {
+    if(stmt_)
+        mysql_stmt_close(stmt_);
+}
+
+bool SqlStmt::bindParams(const std::vector<std::string>& params) {
+    if(!stmt_ || mysql_stmt_param_count(stmt_) != params.size())
+        return false;
+    params_ = params;
+    paramLengths_.assign(params_.size(), 0);
+    paramBinds_.assign(params_.size(), MYSQL_BIND());
+    for(size_t i = 0; i < params_.size(); i++) {
+        paramLengths_[i] = params_[i].size();
+        paramBinds_[i].buffer_type = MYSQL_TYPE_STRING;
+        paramBinds_[i].buffer = &params_[i][0];
+        paramBinds_[i].buffer_length = params_[i].size();
+        paramBinds_[i].length = &paramLengths_[i];
+    }
+    return params_.empty() || !mysql_stmt_bind_param(stmt_, paramBinds_.data());
+}
+
+void SqlStmt::fetchRows(SqlResult& result) {
+    unsigned int fields = mysql_stmt_field_count(stmt_);
+    std::vector<std::string> buffers(fields, std::string(FIELD_SIZE, '\0'));
+    std::vector<unsigned long> lengths(fields, 0);
+    std::vector<my_bool> nulls(fields, 0);
+    std::vector<MYSQL_BIND> binds(fields, MYSQL_BIND());
+    for(unsigned int i = 0; i < fields; i++) {
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = &buffers[i][0];
+        binds[i].buffer_length = FIELD_SIZE;
+        binds[i].length = &lengths[i];
+        binds[i].is_null = &nulls[i];
+    }
+    if(fields > 0 && !mysql_stmt_bind_result(stmt_, binds.data())) {
+        int ret;
+        while((ret = mysql_stmt_fetch(stmt_)) == 0 || ret == MYSQL_DATA_TRUNCATED) {
+            result.rows.emplace_back(fields);
+            for(unsigned int i = 0; i < fields; i++) {
+                std::string& value = result.rows.back()[i];
+                if(nulls[i])
+                    continue;
+                if(lengths[i] <= FIELD_SIZE) {
+                    value.assign(buffers[i].data(), lengths[i]);
+                    continue;
+                }
+                // The field is truncated, fetch it again into a buffer large enough.
+                value.assign(lengths[i], '\0');
+                MYSQL_BIND bind = binds[i];
+                bind.buffer = &value[0];
+                bind.buffer_length = lengths[i];
+                mysql_stmt_fetch_column(stmt_, &bind, i, 0);
+            }
+        }
+    }
+    mysql_stmt_free_result(stmt_);
+}
+
+bool SqlStmt::isLost(unsigned int errnum) {
+    return errnum == CR_SERVER_GONE_ERROR || errnum == CR_SERVER_LOST || errnum == ER_UNKNOWN_STMT_HANDLER;
+}
@@ -0,0 +1,71 @@
+/*
+ * @file        : sqlstmt.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the SqlStmt class, which is designed for
+ *                binding the parameters and fetching the rows of a prepared statement with the
+ *                binary protocol, so the values are never parsed as SQL.
+ */
+
+#ifndef SQLSTMT_H
+#define SQLSTMT_H
+
+#include <mysql/mysql.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The result of a statement.
+ */
+struct SqlResult {
+    bool ok = false;            // Whether the statement succeeded
+    unsigned int errnum = 0;    // The error number of MySQL if it failed
+    std::vector<std::vector<std::string>> rows;    // The rows of a SELECT (NULL as empty)
+};
+
+/**
+ * @class SqlStmt
+ * @brief The SqlStmt class owns a prepared statement of a connection.
+ *
+ * Preparing and executing are left to the caller, in blocking or nonblocking mode,
+ * the statement only keeps the bound parameters alive until it is executed again.
+ */
+class SqlStmt {
+public:
+    explicit SqlStmt(MYSQL* sql) : stmt_(mysql_stmt_init(sql)) {}
+    ~SqlStmt();
+
+    SqlStmt(const SqlStmt&) = delete;
+    SqlStmt& operator=(const SqlStmt&) = delete;
+
+    MYSQL_STMT* get() const { return stmt_; }
+
+    /**
+     * @brief Bind the parameters as strings, they are copied.
+     * @return False if the number of parameters does not match.
+     */
+    bool bindParams(const std::vector<std::string>& params);
+
+    /**
+     * @brief Fetch all the rows of the stored result as strings and free the result.
+     * @param result The rows are appended to it.
+     */
+    void fetchRows(SqlResult& result);
+
+    /**
+     * @brief Whether the error means the statement is gone with the session, so it
+     * should be prepared again after connecting again.
+     */
+    static bool isLost(unsigned int errnum);
+
+private:
+    static const unsigned long FIELD_SIZE = 256;   // Buffer of a field, longer ones are fetched again
+
+    MYSQL_STMT* stmt_;
+    std::vector<std::string> params_;
+    std::vector<unsigned long> paramLengths_;
+    std::vector<MYSQL_BIND> paramBinds_;
+};
+
+#endif //SQLSTMT_H
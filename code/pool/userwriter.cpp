@@ -0,0 +1,147 @@
+/*
+ * @file        : userwriter.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include "userwriter.h"
+
+UserWriter* UserWriter::Instance() {
+    static UserWriter writer;
+    return &writer;
+}
+
+UserWriter::UserWriter() : batchRows_(0), batchMS_(0), closed_(false), enabled_(false) {}
+
+UserWriter::~UserWriter() {
+    close();
+}
+
+bool UserWriter::init(size_t batchRows, int batchMS) {
+    assert(batchRows > 0 && !thread_.joinable());
+    batchRows_ = batchRows;
+    batchMS_ = MS(batchMS);
+    {
+        MYSQL* sql;
+        SqlConnRAII conn(&sql, SqlConnPool::Instance());
+        if(!sql)
+            return false;
+        SqlResult result = SqlConnPool::Instance()->Execute(sql, "SELECT username FROM user", {});
+        if(!result.ok) {
+            LOG_ERROR("UserWriter load names error!");
+            return false;
+        }
+        for(auto& row: result.rows)
+            names_.insert(row[0]);
+    }
+    closed_ = false;
+    thread_ = std::thread(&UserWriter::run_, this);
+    enabled_ = true;
+    LOG_INFO("UserWriter loaded %zu names, batch of %zu users or %d ms", names_.size(), batchRows, batchMS);
+    return true;
+}
+
+void UserWriter::add(const std::string& name, const std::string& pwd, Callback done) {
+    bool queued = false, notify = false;
+    unsigned int errnum = ER_DUP_ENTRY;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        // Not queued once closed, the thread which would insert it is gone.
+        if(closed_)
+            errnum = CR_SERVER_GONE_ERROR;
+        else
+            queued = names_.insert(name).second;
+        if(queued) {
+            queue_.push_back({ name, pwd, std::move(done), Clock::now() });
+            // The thread waits for the first user, then for the batch to fill up.
+            notify = queue_.size() == 1 || queue_.size() == batchRows_;
+        }
+    }
+    if(notify)
+        cond_.notify_one();
+    if(!queued) {
+        SqlResult result;
+        result.errnum = errnum;
+        done(result);
+    }
+}
+
+void UserWriter::run_() {
+    std::unique_lock<std::mutex> locker(mtx_);
+    while(true) {
+        cond_.wait(locker, [this]() { return closed_ || !queue_.empty(); });
+        if(queue_.empty())
+            return;
+        TimeStamp deadline = queue_.front().since + batchMS_;
+        cond_.wait_until(locker, deadline, [this]() { return closed_ || queue_.size() >= batchRows_; });
+        size_t count = std::min(queue_.size(), batchRows_);
+        std::vector<Pending> batch(std::make_move_iterator(queue_.begin()),
+                                   std::make_move_iterator(queue_.begin() + count));
+        queue_.erase(queue_.begin(), queue_.begin() + count);
+        locker.unlock();
+        flush_(batch);
+        locker.lock();
+    }
+}
+
+void UserWriter::flush_(std::vector<Pending>& batch) {
+    // 13 users are inserted as 8, 4 and 1, with the statements of those sizes.
+    size_t count;
+    for(size_t begin = 0; begin < batch.size(); begin += count) {
+        for(count = 1; count * 2 <= batch.size() - begin; count *= 2);
+        flushGroup_(&batch[begin], count);
+    }
+}
+
+void UserWriter::flushGroup_(Pending* users, size_t count) {
+    SqlResult result = insert_(users, count);
+    if(result.ok || count == 1 || SqlStmt::isLost(result.errnum)) {
+        LOG_DEBUG("Insert %zu users %s", count, result.ok ? "ok" : "error");
+        if(!result.ok) {
+            std::lock_guard<std::mutex> locker(mtx_);
+            for(size_t i = 0; i < count; i++)
+                names_.erase(users[i].name);
+        }
+        for(size_t i = 0; i < count; i++)
+            users[i].done(result);
+        return;
+    }
+    // A bad user fails the whole group, so the others are inserted one by one.
+    LOG_WARN("Insert %zu users error, inserting them one by one", count);
+    for(size_t i = 0; i < count; i++)
+        flushGroup_(&users[i], 1);
+}
+
+SqlResult UserWriter::insert_(const Pending* users, size_t count) {
+    SqlResult result;
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    if(!sql) {
+        result.errnum = CR_SERVER_GONE_ERROR;
+        return result;
+    }
+    // Each size of group is a statement prepared once for each connection.
+    std::string query = "INSERT INTO user(username, password) VALUES(?,?)";
+    std::vector<std::string> params;
+    for(size_t i = 0; i < count; i++) {
+        if(i > 0)
+            query += ",(?,?)";
+        params.push_back(users[i].name);
+        params.push_back(users[i].pwd);
+    }
+    return SqlConnPool::Instance()->Execute(sql, query, params);
+}
+
+void UserWriter::close() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        closed_ = true;
+        enabled_ = false;
+    }
+    cond_.notify_one();
+    if(thread_.joinable())
+        thread_.join();
+}
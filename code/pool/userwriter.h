@@ -0,0 +1,117 @@
+/*
+ * @file        : userwriter.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the UserWriter class, which is designed
+ *                for writing the registered users behind the requests, in batches of multi-row
+ *                INSERTs, so a spike of registrations takes a few round trips and connections.
+ */
+
+#ifndef USERWRITER_H
+#define USERWRITER_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <unordered_set>
+#include "sqlconnRAII.h"
+#include "sqlstmt.h"
+#include "../utils/timer/timer.h"
+#include "../log/log.h"
+
+/**
+ * @class UserWriter
+ * @brief The UserWriter class is used to insert the registered users in batches.
+ *
+ * The names in the database are loaded at start into an index, which the new users
+ * are checked against instead of a SELECT for each one, and added to once queued. The
+ * queue is flushed by a thread of the class every batchMS or batchRows users, on a
+ * connection of SqlConnPool, and each user is answered when its batch is committed.
+ * A batch is inserted in groups of powers of two, so each connection keeps a few
+ * statements prepared instead of one for each size of batch. The check is optimistic:
+ * a user added to the table by another writer after the start is not in the index.
+ */
+class UserWriter {
+public:
+    /**
+     * @brief Type definition for the callbacks of users, called with the result of the INSERT.
+     */
+    using Callback = std::function<void(const SqlResult&)>;
+
+    static UserWriter* Instance();
+
+    /**
+     * @brief Load the names and start flushing.
+     * @param batchRows The max number of users in a batch.
+     * @param batchMS The max time a user waits in the queue.
+     * @return A flag whether it succeeds, the users should be inserted one by one otherwise.
+     */
+    bool init(size_t batchRows, int batchMS);
+
+    /**
+     * @brief Whether the users are written in batches, until closed.
+     */
+    bool enabled() const { return enabled_; }
+
+    /**
+     * @brief Queue the user, it is thread-safe.
+     * @param done Called in the thread of the class with the result of the INSERT, or at once
+     *             with ER_DUP_ENTRY if the name is taken and CR_SERVER_GONE_ERROR once closed.
+     */
+    void add(const std::string& name, const std::string& pwd, Callback done);
+
+    /**
+     * @brief Flush the queue and stop the thread.
+     */
+    void close();
+
+private:
+    struct Pending {
+        std::string name;
+        std::string pwd;
+        Callback done;
+        TimeStamp since;
+    };
+
+    UserWriter();
+    ~UserWriter();
+
+    /**
+     * @brief Flush the queue in batches until closed.
+     */
+    void run_();
+
+    /**
+     * @brief Insert the users of the batch in groups of powers of two and answer them.
+     */
+    void flush_(std::vector<Pending>& batch);
+
+    /**
+     * @brief Insert the users of a group and answer them, one by one if one of them fails.
+     */
+    void flushGroup_(Pending* users, size_t count);
+
+    /**
+     * @brief Insert the users with one statement (blocking).
+     */
+    static SqlResult insert_(const Pending* users, size_t count);
+
+    size_t batchRows_;
+    MS batchMS_;
+    bool closed_;
+    std::atomic<bool> enabled_;     // Whether the thread flushes the queue, read without the lock
+
+    std::unordered_set<std::string> names_;     // Names in the table or in the queue
+    std::deque<Pending> queue_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::thread thread_;
+};
+
+#endif //USERWRITER_H
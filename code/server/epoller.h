@@ -53,6 +53,10 @@ public:
         assert(i < events_.size() && i >= 0);
         return events_[i].events;
     }
+
+    int GetFd() const {
+        return epollFd_;
+    }
         
 private:
     int epollFd_;
@@ -14,7 +14,7 @@ WebServer::WebServer(
             int port, int trigMode, int timeoutMS, bool OptLinger,
             int sqlPort, const char* sqlUser, const  char* sqlPwd,
             const char* dbName, int connPoolNum, int threadNum,
-            bool openLog, int logLevel, int logQueSize):
+            bool openLog, int logLevel, int logQueSize, const char* userFile):
             port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
             timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
     {
@@ -22,10 +22,16 @@ WebServer::WebServer(
     assert(srcDir_);
     strncat(srcDir_, "/resources", 16);
     Router::srcDir = std::string(srcDir_);
-    SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
+    // The blocking queries wait for a connection of the pool anyway, so one thread per connection.
+    Router::blockingPool = std::make_shared<ThreadPool>(connPoolNum);
+    bool storeOk = initUserStore_(sqlPort, sqlUser, sqlPwd, dbName, connPoolNum, userFile);
+    HttpConn::resumeHook = std::bind(&WebServer::resume_, this, std::placeholders::_1, 
+                                     std::placeholders::_2, std::placeholders::_3);
 
     initEventMode_(trigMode);
-    if(!initSocket_()) { isClose_ = true;}
+    if(!initSocket_() || !storeOk) { isClose_ = true;}
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoller_->AddFd(wakeupFd_, EPOLLIN);
 
     if(openLog) {
         Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
@@ -42,12 +48,41 @@ WebServer::WebServer(
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
         }
     }
+    initCache_();
+}
+
+bool WebServer::initUserStore_(int sqlPort, const char* sqlUser, const char* sqlPwd,
+                               const char* dbName, int connPoolNum, const char* userFile) {
+    if(userFile) {
+        // The users are kept in the server, in the SQLite file if it is named, without MySQL.
+        auto store = std::make_shared<EmbeddedUserStore>();
+        if(*userFile && !store->open(userFile))
+            return false;
+        Router::userStore = store;
+        return true;
+    }
+    SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum, 
+                                  SQL_POOL_MIN_SIZE, SQL_ACQUIRE_TIMEOUT_MS, SQL_POOL_AFFINE);
+    // Without SqlAsync the queries run on SqlConnPool through Router::blockingPool.
+    if(SQL_ASYNC_CONN_NUM > 0 && SqlAsync::Instance()->init("localhost", sqlPort, sqlUser, sqlPwd, dbName, SQL_ASYNC_CONN_NUM)
+       && !epoller_->AddFd(SqlAsync::Instance()->fd(), EPOLLIN)) {
+        LOG_ERROR("Add SqlAsync error!");
+        SqlAsync::Instance()->close();
+    }
+    // UserWriter loads the names of users, so the registrations are not checked with a SELECT each.
+    if(USER_BATCH_ROWS > 0 && !UserWriter::Instance()->init(USER_BATCH_ROWS, USER_BATCH_MS))
+        LOG_WARN("UserWriter init error, inserting users one by one");
+    Router::userStore = std::make_shared<MySqlUserStore>(Router::blockingPool);
+    return true;
 }
 
 WebServer::~WebServer() {
+    UserWriter::Instance()->close();     // Answers the users queued
     close(listenFd_);
+    close(wakeupFd_);
     isClose_ = true;
     free(srcDir_);
+    SqlAsync::Instance()->close();
     SqlConnPool::Instance()->ClosePool();
 }
 
@@ -74,15 +109,35 @@ void WebServer::initEventMode_(int trigMode) {
         break;
     }
     HttpConn::isET = (connEvent_ & EPOLLET);
+    HttpConn::writeQuota = WRITE_QUOTA;
+    HttpConn::writeTimeQuotaUS = WRITE_TIME_QUOTA_US;
+    HttpConn::bandwidthCap = CONN_BANDWIDTH_CAP;
 }
 
 void WebServer::start() {
     int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
     // if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    nextReport_ = Clock::now() + MS(STATS_INTERVAL_MS);
     while(!isClose_) {
         if(timeoutMS_ > 0) {
             timeMS = timer_->nextTick();
         }
+        if(Clock::now() >= nextReport_) {
+            reportStats_();
+            nextReport_ = Clock::now() + MS(STATS_INTERVAL_MS);
+        }
+        int reportMS = std::chrono::duration_cast<MS>(nextReport_ - Clock::now()).count();
+        if(timeMS < 0 || timeMS > reportMS) {
+            timeMS = reportMS > 0 ? reportMS : 0;
+        }
+        int resumeMS = resumeWrites_();
+        if(resumeMS >= 0 && timeMS > resumeMS) {
+            timeMS = resumeMS;
+        }
+        int sqlMS = SqlAsync::Instance()->handleTimeouts();
+        if(sqlMS >= 0 && timeMS > sqlMS) {
+            timeMS = sqlMS;
+        }
         int eventCnt = epoller_->Wait(timeMS);
         for(int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
@@ -91,6 +146,17 @@ void WebServer::start() {
             if(fd == listenFd_) {
                 dealListen_();
             }
+            else if(fd == FileWatcher::Instance()->fd()) {
+                FileWatcher::Instance()->handleEvents();
+            }
+            else if(fd == SqlAsync::Instance()->fd()) {
+                SqlAsync::Instance()->handleEvents();
+            }
+            else if(fd == wakeupFd_) {
+                uint64_t count;
+                read(wakeupFd_, &count, sizeof(count));
+                resumeRequests_();
+            }
             else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 assert(users_.count(fd) > 0);
                 closeConn_(&users_[fd]);
@@ -109,6 +175,54 @@ void WebServer::start() {
     }
 }
 
+void WebServer::initCache_() {
+    StaticCache::Instance()->init(CACHE_FILE_SIZE, CACHE_CAPACITY);
+    FdCache::Instance()->init(FD_CACHE_CAPACITY);
+    NegativeCache::Instance()->init(NEG_CACHE_CAPACITY, NEG_CACHE_TTL_MS);
+    CompressCache::Instance()->init(COMPRESS_LEVEL, COMPRESS_MIN_SIZE, COMPRESS_MAX_SIZE, COMPRESS_CACHE_CAPACITY);
+    MmapCache::Instance()->init(MMAP_MIN_SIZE, MMAP_MAX_SIZE, MMAP_HOT_HITS, MMAP_CAPACITY);
+    RouteCache::Instance()->init(ROUTE_CACHE_CAPACITY);
+    UserCache::Instance()->init(USER_CACHE_CAPACITY, USER_CACHE_TTL_MS, USER_CACHE_NEG_TTL_MS);
+    FileWatcher* watcher = FileWatcher::Instance();
+    if(!watcher->init(Router::srcDir) || !epoller_->AddFd(watcher->fd(), EPOLLIN)) {
+        // Without invalidation the cached content may become stale.
+        LOG_WARN("FileWatcher init error, static file cache disabled!");
+        StaticCache::Instance()->init(0, 0);
+        FdCache::Instance()->init(0);
+        NegativeCache::Instance()->init(0, 0);
+        MmapCache::Instance()->init(0, 0, 0, 0);
+        RouteCache::Instance()->init(0);
+        return;
+    }
+    watcher->subscribe([](const std::string& path, bool isDir) {
+        StaticCache::Instance()->invalidate(path, isDir);
+        FdCache::Instance()->invalidate(path, isDir);
+        NegativeCache::Instance()->invalidate(path, isDir);
+        MmapCache::Instance()->invalidate(path, isDir);
+        RouteCache::Instance()->invalidate(path, isDir);
+    });
+}
+
+void WebServer::reportStats_() {
+    CompressCache* compress = CompressCache::Instance();
+    size_t hits = compress->hitCount(), misses = compress->missCount();
+    LOG_INFO("CompressCache hit: %zu, miss: %zu, hit ratio: %.2f%%", 
+             hits, misses, hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+    SqlConnPool* pool = SqlConnPool::Instance();
+    std::vector<size_t> waits = pool->WaitHistogram();
+    std::string histogram;
+    for(size_t i = 0; i < waits.size(); i++) {
+        histogram += i < waits.size() - 1 ? " <" + std::to_string(SqlConnPool::WAIT_BOUNDS_MS[i]) + "ms: " : " more: ";
+        histogram += std::to_string(waits[i]);
+    }
+    LOG_INFO("SqlConnPool open: %d, idle: %d, timeout: %zu, wait%s", 
+             pool->OpenCount(), pool->IdleCount(), pool->TimeoutCount(), histogram.c_str());
+    UserCache* users = UserCache::Instance();
+    hits = users->hitCount(), misses = users->missCount();
+    LOG_INFO("UserCache hit: %zu, miss: %zu, hit ratio: %.2f%%", 
+             hits, misses, hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+}
+
 void WebServer::sendError_(int fd, const char*info) {
     assert(fd > 0);
     int ret = send(fd, info, strlen(info), 0);
@@ -120,6 +234,10 @@ void WebServer::sendError_(int fd, const char*info) {
 
 void WebServer::closeConn_(HttpConn* client) {
     assert(client);
+    {
+        std::lock_guard<std::mutex> locker(delayMtx_);
+        delayed_.erase(client->getFd());
+    }
     // LOG_INFO("Client[%d] quit, userCount:%d", client->getFd(), users_.size());
     epoller_->DelFd(client->getFd());
     users_.erase(client->getFd());
@@ -190,12 +308,18 @@ void WebServer::onRead_(HttpConn* client) {
 }
 
 void WebServer::onProcess(HttpConn* client) {
-    if(client->process()) {
+    switch(client->process()) {
+    case HttpConn::WAIT_WRITE:
         // LOG_DEBUG("Waiting for Writing");
         epoller_->ModFd(client->getFd(), connEvent_ | EPOLLOUT);
-    } else {
+        break;
+    case HttpConn::WAIT_READ:
         // LOG_DEBUG("Waiting for Reading");
         epoller_->ModFd(client->getFd(), connEvent_ | EPOLLIN);
+        break;
+    case HttpConn::SUSPENDED:
+        // No events until the result is ready, see resume_.
+        break;
     }
 }
 
@@ -224,10 +348,78 @@ void WebServer::onWrite_(HttpConn* client) {
     }
     /* 继续传输 */
     // LOG_DEBUG("Remaining %d bytes, Continue Sending", client->toWriteBytes());
+    int delayMS = client->throttleMS();
+    if(delayMS > 0) {
+        delayWrite_(client, delayMS);
+        return;
+    }
     epoller_->ModFd(client->getFd(), connEvent_ | EPOLLOUT);
     return;
 }
 
+void WebServer::delayWrite_(HttpConn* client, int delayMS) {
+    assert(client);
+    TimeStamp resumeTime = Clock::now() + MS(delayMS);
+    std::lock_guard<std::mutex> locker(delayMtx_);
+    delayed_[client->getFd()] = resumeTime;
+    delayedQue_.emplace(resumeTime, client->getFd());
+    // The event loop may be waiting with a longer timeout.
+    uint64_t one = 1;
+    write(wakeupFd_, &one, sizeof(one));
+}
+
+int WebServer::resumeWrites_() {
+    std::lock_guard<std::mutex> locker(delayMtx_);
+    while(!delayedQue_.empty()) {
+        auto next = delayedQue_.top();
+        auto it = delayed_.find(next.second);
+        if(it == delayed_.end() || it->second != next.first) {
+            // The connection is closed or delayed again.
+            delayedQue_.pop();
+            continue;
+        }
+        int timeMS = std::chrono::duration_cast<MS>(next.first - Clock::now()).count();
+        if(timeMS > 0)
+            return timeMS;
+        delayedQue_.pop();
+        delayed_.erase(it);
+        epoller_->ModFd(next.second, connEvent_ | EPOLLOUT);
+    }
+    return -1;
+}
+
+void WebServer::resume_(int fd, uint64_t id, HttpConn::Completion completion) {
+    {
+        std::lock_guard<std::mutex> locker(resumeMtx_);
+        resumed_.emplace_back(fd, id, std::move(completion));
+    }
+    uint64_t one = 1;
+    write(wakeupFd_, &one, sizeof(one));
+}
+
+void WebServer::resumeRequests_() {
+    std::vector<std::tuple<int, uint64_t, HttpConn::Completion>> resumed;
+    {
+        std::lock_guard<std::mutex> locker(resumeMtx_);
+        resumed.swap(resumed_);
+    }
+    for(auto& item: resumed) {
+        auto it = users_.find(std::get<0>(item));
+        // The connection may have been closed (and the fd reused) while suspended.
+        if(it == users_.end() || it->second.getId() != std::get<1>(item) || !it->second.isSuspended())
+            continue;
+        HttpConn* client = &it->second;
+        extentTime_(client);
+        threadpool_->AddTask(std::bind(&WebServer::onResume_, this, client, std::move(std::get<2>(item))));
+    }
+}
+
+void WebServer::onResume_(HttpConn* client, const HttpConn::Completion& completion) {
+    assert(client);
+    client->resume(completion);
+    epoller_->ModFd(client->getFd(), connEvent_ | EPOLLOUT);
+}
+
 /* Create listenFd */
 bool WebServer::initSocket_() {
     int ret;
@@ -10,11 +10,15 @@
 #define WEBSERVER_H
 
 #include <unordered_map>
+#include <queue>
+#include <tuple>
+#include <mutex>
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
 #include <assert.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <sys/eventfd.h> // eventfd()
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -22,7 +26,17 @@
 #include "../utils/timer/timer.h"
 #include "../pool/threadpool.h"
 #include "../pool/sqlconnRAII.h"
+#include "../pool/sqlasync.h"
 #include "../http/router.h"
+#include "../store/mysqluserstore.h"
+#include "../store/embeddeduserstore.h"
+#include "../cache/staticcache.h"
+#include "../cache/fdcache.h"
+#include "../cache/negativecache.h"
+#include "../cache/compresscache.h"
+#include "../cache/mmapcache.h"
+#include "../cache/routecache.h"
+#include "../utils/watcher/filewatcher.h"
 #include "../log/log.h"
 
 class WebServer {
@@ -31,13 +45,17 @@ public:
         int port, int trigMode, int timeoutMS, bool OptLinger, 
         int sqlPort, const char* sqlUser, const  char* sqlPwd, 
         const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+        bool openLog, int logLevel, int logQueSize, const char* userFile = nullptr);
 
     ~WebServer();
     void start();
 
 private:
     bool initSocket_(); 
+    void initCache_();
+    bool initUserStore_(int sqlPort, const char* sqlUser, const char* sqlPwd,
+                        const char* dbName, int connPoolNum, const char* userFile);
+    void reportStats_();
     void initEventMode_(int trigMode);
     void addClient_(int fd, sockaddr_in addr);
   
@@ -53,7 +71,41 @@ private:
     void onWrite_(HttpConn* client);
     void onProcess(HttpConn* client);
 
+    void delayWrite_(HttpConn* client, int delayMS);
+    int resumeWrites_();
+
+    void resume_(int fd, uint64_t id, HttpConn::Completion completion);
+    void resumeRequests_();
+    void onResume_(HttpConn* client, const HttpConn::Completion& completion);
+
     static const int MAX_FD = 65536;
+    static const size_t CACHE_FILE_SIZE = 256 * 1024;      // Max size of a file cached in memory
+    static const size_t CACHE_CAPACITY = 64 * 1024 * 1024; // Memory cap of the static file cache
+    static const size_t FD_CACHE_CAPACITY = 1024;          // Max number of cached open files
+    static const size_t NEG_CACHE_CAPACITY = 4096;         // Max number of cached missing paths
+    static const int NEG_CACHE_TTL_MS = 10000;             // Time a missing path is remembered
+    static const int COMPRESS_LEVEL = 6;                   // zlib level of on the fly compression
+    static const size_t COMPRESS_MIN_SIZE = 1024;          // Min size of a file compressed on the fly
+    static const size_t COMPRESS_MAX_SIZE = 8 * 1024 * 1024;        // Max size of a file compressed on the fly
+    static const size_t COMPRESS_CACHE_CAPACITY = 32 * 1024 * 1024; // Memory cap of the compressed files
+    static const size_t MMAP_MIN_SIZE = CACHE_FILE_SIZE;    // Min size of a file served from a mapping
+    static const size_t MMAP_MAX_SIZE = 16 * 1024 * 1024;  // Max size of a file served from a mapping
+    static const unsigned MMAP_HOT_HITS = 4;               // Requests before a file is mapped
+    static const size_t MMAP_CAPACITY = 0;                 // Cap of the mapped bytes (0 to serve with sendfile)
+    static const size_t ROUTE_CACHE_CAPACITY = 4096;       // Max number of resolved request targets
+    static const size_t USER_CACHE_CAPACITY = 65536;       // Max number of cached users
+    static const int USER_CACHE_TTL_MS = 30000;            // Time a user is remembered
+    static const int USER_CACHE_NEG_TTL_MS = 5000;         // Time a missing user is remembered
+    static const int SQL_POOL_MIN_SIZE = 2;                // Blocking MySQL connections opened at start
+    static const int SQL_ACQUIRE_TIMEOUT_MS = 3000;        // Max time to wait for a blocking MySQL connection
+    static const bool SQL_POOL_AFFINE = true;              // Lease the blocking MySQL connections to threads
+    static const int SQL_ASYNC_CONN_NUM = 4;               // Nonblocking MySQL connections (0 to query on SqlConnPool)
+    static const size_t USER_BATCH_ROWS = 0;               // Max registrations in an INSERT (0 to insert them one by one)
+    static const int USER_BATCH_MS = 10;                   // Max time a registration waits for its INSERT
+    static const int STATS_INTERVAL_MS = 60000;            // Interval of logging the statistics
+    static const size_t WRITE_QUOTA = 1024 * 1024;         // Max bytes written to a connection in one turn
+    static const int WRITE_TIME_QUOTA_US = 5000;           // Max time spent writing to a connection in one turn
+    static const size_t CONN_BANDWIDTH_CAP = 0;            // Max bytes per second of a connection (0 for unlimited)
 
     static int setNonblock(int fd);
 
@@ -64,6 +116,8 @@ private:
     int listenFd_;
     char* srcDir_;
     
+    TimeStamp nextReport_;
+
     uint32_t listenEvent_;
     uint32_t connEvent_;
    
@@ -71,6 +125,17 @@ private:
     std::unique_ptr<ThreadPool> threadpool_;
     std::unique_ptr<Epoller> epoller_;
     std::unordered_map<int, HttpConn> users_;
+
+    // Connections waiting for the bandwidth cap, resumed by the event loop
+    std::priority_queue<std::pair<TimeStamp, int>, std::vector<std::pair<TimeStamp, int>>, 
+                        std::greater<std::pair<TimeStamp, int>>> delayedQue_;
+    std::unordered_map<int, TimeStamp> delayed_;
+    std::mutex delayMtx_;
+    int wakeupFd_;  // To wake up the event loop when a connection is delayed or resumed
+
+    // Suspended requests whose results are ready, as (fd, id of the connection, completion)
+    std::vector<std::tuple<int, uint64_t, HttpConn::Completion>> resumed_;
+    std::mutex resumeMtx_;
 };
 
 #endif //WEBSERVER_H
\ No newline at end of file
@@ -0,0 +1,101 @@
+/*
+ * @file        : embeddeduserstore.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "embeddeduserstore.h"
+
+// WAL with NORMAL sync commits without an fsync each, a crash loses the last users at most.
+static constexpr const char* USER_SCHEMA =
+    "PRAGMA journal_mode=WAL;"
+    "PRAGMA synchronous=NORMAL;"
+    "CREATE TABLE IF NOT EXISTS user(username TEXT PRIMARY KEY, password TEXT NOT NULL);";
+static constexpr const char* USER_SELECT_ALL = "SELECT username, password FROM user";
+static constexpr const char* USER_INSERT = "INSERT INTO user(username, password) VALUES(?,?)";
+
+EmbeddedUserStore::EmbeddedUserStore() : db_(nullptr), insert_(nullptr) {}
+
+EmbeddedUserStore::~EmbeddedUserStore() {
+    close_();
+}
+
+bool EmbeddedUserStore::open(const std::string& path) {
+    std::unique_lock<std::shared_mutex> locker(mtx_);
+    close_();
+    sqlite3_stmt* select = nullptr;
+    if(sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, nullptr) != SQLITE_OK
+       || sqlite3_exec(db_, USER_SCHEMA, nullptr, nullptr, nullptr) != SQLITE_OK
+       || sqlite3_prepare_v2(db_, USER_SELECT_ALL, -1, &select, nullptr) != SQLITE_OK
+       || sqlite3_prepare_v2(db_, USER_INSERT, -1, &insert_, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite open %s error: %s", path.c_str(), db_ ? sqlite3_errmsg(db_) : "out of memory");
+        sqlite3_finalize(select);
+        close_();
+        return false;
+    }
+    int ret;
+    while((ret = sqlite3_step(select)) == SQLITE_ROW) {
+        users_[reinterpret_cast<const char*>(sqlite3_column_text(select, 0))] =
+            reinterpret_cast<const char*>(sqlite3_column_text(select, 1));
+    }
+    sqlite3_finalize(select);
+    if(ret != SQLITE_DONE) {
+        LOG_ERROR("SQLite load %s error: %s", path.c_str(), sqlite3_errmsg(db_));
+        close_();
+        return false;
+    }
+    LOG_INFO("SQLite %s loaded %zu users", path.c_str(), users_.size());
+    return true;
+}
+
+void EmbeddedUserStore::close_() {
+    sqlite3_finalize(insert_);
+    insert_ = nullptr;
+    sqlite3_close(db_);
+    db_ = nullptr;
+}
+
+bool EmbeddedUserStore::tryVerify(const std::string& name, const std::string& pwd, bool& flag) {
+    std::shared_lock<std::shared_mutex> locker(mtx_);
+    auto it = users_.find(name);
+    flag = it != users_.end() && it->second == pwd;
+    if(!flag)
+        LOG_DEBUG("%s", it == users_.end() ? "User not found!" : "Password error!");
+    return true;
+}
+
+void EmbeddedUserStore::verify(const std::string& name, const std::string& pwd, Callback done) {
+    bool flag;
+    tryVerify(name, pwd, flag);
+    done(flag);
+}
+
+bool EmbeddedUserStore::tryCreate(const std::string& name, const std::string& pwd, bool& flag) {
+    std::unique_lock<std::shared_mutex> locker(mtx_);
+    flag = false;
+    if(users_.count(name)) {
+        LOG_DEBUG("Username used!");
+        return true;
+    }
+    if(insert_) {
+        sqlite3_bind_text(insert_, 1, name.data(), name.size(), SQLITE_STATIC);
+        sqlite3_bind_text(insert_, 2, pwd.data(), pwd.size(), SQLITE_STATIC);
+        int ret = sqlite3_step(insert_);
+        sqlite3_reset(insert_);
+        sqlite3_clear_bindings(insert_);
+        if(ret != SQLITE_DONE) {
+            LOG_WARN("SQLite insert error: %s", sqlite3_errmsg(db_));
+            return true;
+        }
+    }
+    users_.emplace(name, pwd);
+    flag = true;
+    return true;
+}
+
+void EmbeddedUserStore::create(const std::string& name, const std::string& pwd, Callback done) {
+    bool flag;
+    tryCreate(name, pwd, flag);
+    done(flag);
+}
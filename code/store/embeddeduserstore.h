@@ -0,0 +1,61 @@
+/*
+ * @file        : embeddeduserstore.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the EmbeddedUserStore class, which keeps the
+ *                users in the server, so it runs without MySQL, such as for benchmarks of the HTTP path.
+ */
+
+#ifndef EMBEDDED_USER_STORE_H
+#define EMBEDDED_USER_STORE_H
+
+#include <string>
+#include <shared_mutex>
+#include <unordered_map>
+#include <sqlite3.h>
+#include "userstore.h"
+#include "../log/log.h"
+
+/**
+ * @class EmbeddedUserStore
+ * @brief The EmbeddedUserStore class is used to keep the users in a hash table.
+ *
+ * The users may be kept in a SQLite file too, which is loaded at start and written
+ * through on each registration, so they are kept across restarts. Every call is
+ * answered without waiting, by the try functions.
+ */
+class EmbeddedUserStore : public UserStore {
+public:
+    EmbeddedUserStore();
+    ~EmbeddedUserStore() override;
+
+    EmbeddedUserStore(const EmbeddedUserStore&) = delete;
+    EmbeddedUserStore& operator=(const EmbeddedUserStore&) = delete;
+
+    /**
+     * @brief Open the SQLite file and load its users.
+     * @param path The path of the file, created if missing.
+     * @return A flag whether it succeeds.
+     */
+    bool open(const std::string& path);
+
+    bool tryVerify(const std::string& name, const std::string& pwd, bool& flag) override;
+    void verify(const std::string& name, const std::string& pwd, Callback done) override;
+    bool tryCreate(const std::string& name, const std::string& pwd, bool& flag) override;
+    void create(const std::string& name, const std::string& pwd, Callback done) override;
+
+private:
+    /**
+     * @brief Close the SQLite file, the users are kept in memory.
+     */
+    void close_();
+
+    std::unordered_map<std::string, std::string> users_;    // Password by name
+    std::shared_mutex mtx_;
+
+    sqlite3* db_;
+    sqlite3_stmt* insert_;
+};
+
+#endif //EMBEDDED_USER_STORE_H
@@ -0,0 +1,165 @@
+/*
+ * @file        : mysqluserstore.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "mysqluserstore.h"
+
+// Statements of the user table, the values are bound as parameters.
+static constexpr const char* USER_SELECT = "SELECT password FROM user WHERE username=? LIMIT 1";
+static constexpr const char* USER_INSERT = "INSERT INTO user(username, password) VALUES(?,?)";
+
+MySqlUserStore::MySqlUserStore(std::shared_ptr<ThreadPool> blockingPool) : blockingPool_(std::move(blockingPool)) {
+    assert(blockingPool_);
+}
+
+bool MySqlUserStore::tryVerify(const std::string& name, const std::string& pwd, bool& flag) {
+    UserCache::User user;
+    if(!UserCache::Instance()->get(name, user))
+        return false;
+    LOG_DEBUG("User cached!");
+    flag = user.exists && user.password == pwd;
+    return true;
+}
+
+void MySqlUserStore::verify(const std::string& name, const std::string& pwd, Callback done) {
+    lookup_(name, [pwd, done = std::move(done)](const SqlResult& result) {
+        done(checkUser_(pwd, result));
+    });
+}
+
+void MySqlUserStore::lookup_(const std::string& name, std::function<void(const SqlResult&)> done) {
+    lookups_.call(name, std::move(done), [this, name](std::function<void(const SqlResult&)> finish) {
+        // The user is cached once for all the callers, before they are answered, unless a
+        // registration changes it while the SELECT runs.
+        unsigned long generation = UserCache::Instance()->generation(name);
+        auto cache = [name, generation, finish = std::move(finish)](const SqlResult& result) {
+            cacheUser_(name, generation, result);
+            finish(result);
+        };
+        if(SqlAsync::Instance()->fd() < 0) {
+            blockingPool_->AddTask([name, cache = std::move(cache)]() { cache(selectUser_(name)); });
+            return;
+        }
+        LOG_DEBUG("%s [%s]", USER_SELECT, name.c_str());
+        SqlAsync::Instance()->query(USER_SELECT, { name }, std::move(cache));
+    });
+}
+
+SqlResult MySqlUserStore::selectUser_(const std::string& name) {
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    if (!sql) {
+        LOG_WARN("No MySql connection in time!");
+        SqlResult result;
+        result.errnum = CR_SERVER_GONE_ERROR;
+        return result;
+    }
+
+    LOG_DEBUG("%s [%s]", USER_SELECT, name.c_str());
+    return SqlConnPool::Instance()->Execute(sql, USER_SELECT, { name });
+}
+
+void MySqlUserStore::cacheUser_(const std::string& name, unsigned long generation, const SqlResult& result) {
+    if (!result.ok)
+        return;
+    UserCache::User user;
+    user.exists = !result.rows.empty();
+    if (user.exists)
+        user.password = result.rows[0][0];
+    if (!UserCache::Instance()->fill(name, user, generation))
+        LOG_DEBUG("User %s changed during the lookup!", name.c_str());
+}
+
+bool MySqlUserStore::checkUser_(const std::string& pwd, const SqlResult& result) {
+    if (!result.ok) {
+        LOG_DEBUG("Query error!");
+        return false;
+    }
+    if (result.rows.empty()) {
+        LOG_DEBUG("User not found!");
+        return false;
+    }
+    bool flag = pwd == result.rows[0][0];
+    if (!flag)
+        LOG_DEBUG("Password error!");
+    return flag;
+}
+
+bool MySqlUserStore::tryCreate(const std::string& name, const std::string&, bool& flag) {
+    UserCache::User user;
+    if(!UserCache::Instance()->get(name, user) || !user.exists)
+        return false;   // A missing user may have been created since, so only a known one is answered here.
+    LOG_DEBUG("Username used!");
+    flag = false;
+    return true;
+}
+
+void MySqlUserStore::create(const std::string& name, const std::string& pwd, Callback done) {
+    if(UserWriter::Instance()->enabled()) {
+        UserWriter::Instance()->add(name, pwd, [name, pwd, done = std::move(done)](const SqlResult& result) {
+            done(addUser_(name, pwd, result));
+        });
+    }
+    else if(SqlAsync::Instance()->fd() < 0)
+        blockingPool_->AddTask([name, pwd, done = std::move(done)]() { done(createUser_(name, pwd)); });
+    else
+        createUserAsync_(name, pwd, std::move(done));
+}
+
+void MySqlUserStore::createUserAsync_(const std::string& name, const std::string& pwd, Callback done) {
+    LOG_DEBUG("%s [%s]", USER_SELECT, name.c_str());
+    SqlAsync::Instance()->query(USER_SELECT, { name }, [name, pwd, done = std::move(done)](const SqlAsync::Result& result) {
+        if(!result.ok) {
+            LOG_DEBUG("Query error!");
+            done(false);
+            return;
+        }
+        if(!result.rows.empty()) {
+            LOG_DEBUG("Username used!");
+            UserCache::Instance()->add(name, { true, result.rows[0][0] });
+            done(false);
+            return;
+        }
+        LOG_DEBUG("register!");
+        SqlAsync::Instance()->query(USER_INSERT, { name, pwd }, [name, pwd, done](const SqlAsync::Result& result) {
+            done(addUser_(name, pwd, result));
+        });
+    });
+}
+
+bool MySqlUserStore::createUser_(const std::string& name, const std::string& pwd) {
+    MYSQL* sql;
+    SqlConnRAII conn(&sql, SqlConnPool::Instance());
+    if (!sql) {
+        LOG_WARN("No MySql connection in time!");
+        return false;
+    }
+
+    LOG_DEBUG("%s [%s]", USER_SELECT, name.c_str());
+    SqlResult result = SqlConnPool::Instance()->Execute(sql, USER_SELECT, { name });
+    if (!result.ok) {
+        LOG_DEBUG("Query error!");
+        return false;
+    }
+    if (!result.rows.empty()) {
+        LOG_DEBUG("Username used!");
+        UserCache::Instance()->add(name, { true, result.rows[0][0] });
+        return false;
+    }
+
+    LOG_DEBUG("register!");
+    return addUser_(name, pwd, SqlConnPool::Instance()->Execute(sql, USER_INSERT, { name, pwd }));
+}
+
+bool MySqlUserStore::addUser_(const std::string& name, const std::string& pwd, const SqlResult& result) {
+    if(!result.ok) {
+        LOG_DEBUG( "Insert error!");
+        UserCache::Instance()->erase(name);     // The user may exist, ask the database next time
+        return false;
+    }
+    UserCache::Instance()->add(name, { true, pwd });
+    return true;
+}
@@ -0,0 +1,94 @@
+/*
+ * @file        : mysqluserstore.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the MySqlUserStore class, which keeps the
+ *                users in the user table of MySQL, behind UserCache.
+ */
+
+#ifndef MYSQL_USER_STORE_H
+#define MYSQL_USER_STORE_H
+
+#include <memory>
+#include "userstore.h"
+#include "../cache/usercache.h"
+#include "../cache/singleflight.h"
+#include "../pool/threadpool.h"
+#include "../pool/sqlconnRAII.h"
+#include "../pool/sqlasync.h"
+#include "../pool/userwriter.h"
+#include "../log/log.h"
+
+/**
+ * @class MySqlUserStore
+ * @brief The MySqlUserStore class is used to keep the users in MySQL.
+ *
+ * The queries run on SqlAsync if it is connected, and on SqlConnPool through the
+ * blocking pool otherwise. The registrations are queued on UserWriter if it is
+ * enabled. The users found are cached in UserCache, which the try functions read,
+ * and the concurrent lookups of a name missing in it share one query.
+ */
+class MySqlUserStore : public UserStore {
+public:
+    /**
+     * @brief Constructor for MySqlUserStore.
+     * @param blockingPool Runs the blocking queries when SqlAsync is not connected.
+     */
+    explicit MySqlUserStore(std::shared_ptr<ThreadPool> blockingPool);
+
+    bool tryVerify(const std::string& name, const std::string& pwd, bool& flag) override;
+    void verify(const std::string& name, const std::string& pwd, Callback done) override;
+    bool tryCreate(const std::string& name, const std::string& pwd, bool& flag) override;
+    void create(const std::string& name, const std::string& pwd, Callback done) override;
+
+private:
+    /**
+     * @brief Select the user, sharing the query with the concurrent lookups of the name.
+     * @param done Called with the result of the SELECT, after the user is cached.
+     */
+    void lookup_(const std::string& name, std::function<void(const SqlResult&)> done);
+
+    /**
+     * @brief Select the user in the database (blocking).
+     */
+    static SqlResult selectUser_(const std::string& name);
+
+    /**
+     * @brief Cache the user selected, unless the query failed or the user is changed since.
+     * @param generation The generation of UserCache taken before the SELECT.
+     * @param result The result of the SELECT of the user.
+     */
+    static void cacheUser_(const std::string& name, unsigned long generation, const SqlResult& result);
+
+    /**
+     * @brief Check the password against the user selected.
+     * @param result The result of the SELECT of the user.
+     * @return True if the user exists with the password.
+     */
+    static bool checkUser_(const std::string& pwd, const SqlResult& result);
+
+    /**
+     * @brief Add the user with the password to the database (blocking).
+     * @return True if the user is added.
+     */
+    static bool createUser_(const std::string& name, const std::string& pwd);
+
+    /**
+     * @brief Add the user with the password with the queries on SqlAsync.
+     * @param done Called with true if the user is added, in the event loop.
+     */
+    static void createUserAsync_(const std::string& name, const std::string& pwd, Callback done);
+
+    /**
+     * @brief Cache the user inserted, or forget it if the INSERT failed.
+     * @param result The result of the INSERT of the user.
+     * @return True if the user is added.
+     */
+    static bool addUser_(const std::string& name, const std::string& pwd, const SqlResult& result);
+
+    std::shared_ptr<ThreadPool> blockingPool_;
+    SingleFlight<std::string, SqlResult> lookups_;     // The concurrent logins of a name share a SELECT
+};
+
+#endif //MYSQL_USER_STORE_H
@@ -0,0 +1,59 @@
+/*
+ * @file        : userstore.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the UserStore interface, which the handlers
+ *                of login and registration use, so the users may be kept in MySQL or in the server.
+ */
+
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <string>
+#include <functional>
+
+/**
+ * @class UserStore
+ * @brief The UserStore class is the interface of the backends keeping the users.
+ *
+ * The try functions answer without waiting when they can, such as from a cache, and
+ * the others answer through their callback, which may be called from any thread.
+ */
+class UserStore {
+public:
+    /**
+     * @brief Type definition for the callbacks of the answers.
+     */
+    using Callback = std::function<void(bool)>;
+
+    virtual ~UserStore() = default;
+
+    /**
+     * @brief Check the password of the user without waiting.
+     * @param flag Set to true if the user exists with the password.
+     * @return False if it needs a round trip, verify should be called then.
+     */
+    virtual bool tryVerify(const std::string& name, const std::string& pwd, bool& flag) = 0;
+
+    /**
+     * @brief Check the password of the user.
+     * @param done Called with true if the user exists with the password.
+     */
+    virtual void verify(const std::string& name, const std::string& pwd, Callback done) = 0;
+
+    /**
+     * @brief Add the user with the password without waiting.
+     * @param flag Set to true if the user is added.
+     * @return False if it needs a round trip, create should be called then.
+     */
+    virtual bool tryCreate(const std::string& name, const std::string& pwd, bool& flag) = 0;
+
+    /**
+     * @brief Add the user with the password, unless the name is taken.
+     * @param done Called with true if the user is added.
+     */
+    virtual void create(const std::string& name, const std::string& pwd, Callback done) = 0;
+};
+
+#endif //USER_STORE_H
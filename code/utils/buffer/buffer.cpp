@@ -21,7 +21,7 @@ void Buffer::addData(const char* str, size_t len){
     if(writePos_ + len <= buffer_.size()){
         std::copy(str, str + len, buffer_.data() + writePos_);
     }
-    else if(readPos_ + len <= buffer_.size()){
+    else if(size() + len <= buffer_.size()){
         std::copy(buffer_.data() + readPos_, buffer_.data() + writePos_, buffer_.data());
         writePos_ -= readPos_;
         readPos_ = 0;
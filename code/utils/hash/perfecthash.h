@@ -0,0 +1,125 @@
+/*
+ * @file        : perfecthash.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration and definition of the PerfectHash class, which
+ *                is designed for lookup tables of fixed keys built at compile time. The seed of the
+ *                hash is searched until every key lands in its own slot, so a lookup is one probe
+ *                and one comparison without any allocation.
+ */
+
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+#include <array>
+
+/**
+ * @brief Spread the high bits of the hash to the low bits, which select the slot.
+ */
+constexpr uint32_t perfectHashMix(uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+/**
+ * @brief FNV-1a hash of the key mixed with the seed.
+ */
+constexpr uint32_t perfectHashOf(std::string_view key, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for(char c: key) {
+        hash ^= (unsigned char)c;
+        hash *= 16777619u;
+    }
+    return perfectHashMix(hash);
+}
+
+constexpr uint32_t perfectHashOf(int key, uint32_t seed) {
+    return perfectHashMix(((uint32_t)key ^ seed) * 2654435761u);
+}
+
+/**
+ * @brief An entry of PerfectHash, an aggregate so that tables are written as braced lists.
+ */
+template<class K, class V>
+struct PerfectHashEntry {
+    K key{};
+    V value{};
+};
+
+/**
+ * @class PerfectHash
+ * @brief The PerfectHash class maps N fixed keys to values with a collision-free table.
+ *
+ * Keys of other types need a constexpr perfectHashOf(key, seed) overload and operator==.
+ */
+template<class K, class V, size_t N>
+class PerfectHash {
+public:
+    using Entry = PerfectHashEntry<K, V>;
+
+    constexpr PerfectHash(const Entry (&entries)[N]) : entries_(), slots_(), seed_(0) {
+        for(size_t i = 0; i < N; i++)
+            entries_[i] = entries[i];
+        while(!place_())
+            seed_++;
+    }
+
+    /**
+     * @brief Find the value of the key.
+     * @return The pointer to the value, nullptr if the key is not in the table.
+     */
+    constexpr const V* find(const K& key) const {
+        int slot = slots_[perfectHashOf(key, seed_) & (SLOTS - 1)];
+        return slot >= 0 && entries_[slot].key == key ? &entries_[slot].value : nullptr;
+    }
+
+    constexpr size_t size() const { return N; }
+    constexpr const Entry* begin() const { return entries_.data(); }
+    constexpr const Entry* end() const { return entries_.data() + N; }
+
+private:
+    // Twice as many slots as keys (a power of two) keeps the seed search short.
+    static constexpr size_t slotsFor_(size_t n) {
+        size_t slots = 1;
+        while(slots < 2 * n)
+            slots <<= 1;
+        return slots;
+    }
+    static constexpr size_t SLOTS = slotsFor_(N);
+
+    /**
+     * @brief Place every key with the current seed.
+     * @return False if two keys collide.
+     */
+    constexpr bool place_() {
+        for(size_t i = 0; i < SLOTS; i++)
+            slots_[i] = -1;
+        for(size_t i = 0; i < N; i++) {
+            size_t slot = perfectHashOf(entries_[i].key, seed_) & (SLOTS - 1);
+            if(slots_[slot] >= 0)
+                return false;
+            slots_[slot] = (int16_t)i;
+        }
+        return true;
+    }
+
+    std::array<Entry, N> entries_;
+    std::array<int16_t, SLOTS> slots_;  // Index of the entry in each slot, -1 if empty
+    uint32_t seed_;
+};
+
+/**
+ * @brief Build a PerfectHash from a braced list, such as makePerfectHash<int, std::string_view>({{1, "a"}}).
+ */
+template<class K, class V, size_t N>
+constexpr PerfectHash<K, V, N> makePerfectHash(const PerfectHashEntry<K, V> (&entries)[N]) {
+    return PerfectHash<K, V, N>(entries);
+}
+
+#endif //PERFECT_HASH_H
@@ -0,0 +1,113 @@
+/*
+ * @file        : filewatcher.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ */
+
+#include "filewatcher.h"
+
+const uint32_t FileWatcher::WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE 
+                                       | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+FileWatcher* FileWatcher::Instance() {
+    static FileWatcher watcher;
+    return &watcher;
+}
+
+FileWatcher::FileWatcher() : inotifyFd_(-1) {}
+
+FileWatcher::~FileWatcher() {
+    if(inotifyFd_ >= 0)
+        close(inotifyFd_);
+}
+
+bool FileWatcher::init(const std::string& root) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(inotifyFd_ >= 0)
+        return true;
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd_ < 0) {
+        LOG_ERROR("inotify init error: %s", strerror(errno));
+        return false;
+    }
+    root_ = root;
+    watchTree_("");
+    LOG_INFO("FileWatcher watching %s with %d directories", root_.c_str(), (int)wdPath_.size());
+    return true;
+}
+
+int FileWatcher::fd() const {
+    return inotifyFd_;
+}
+
+void FileWatcher::subscribe(Callback cb) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    subscribers_.push_back(std::move(cb));
+}
+
+void FileWatcher::watchTree_(const std::string& dir) {
+    std::string fullPath = root_ + dir;
+    int wd = inotify_add_watch(inotifyFd_, fullPath.c_str(), WATCH_MASK);
+    if(wd < 0) {
+        LOG_WARN("inotify watch %s error: %s", fullPath.c_str(), strerror(errno));
+        return;
+    }
+    wdPath_[wd] = dir;
+
+    DIR* dp = opendir(fullPath.c_str());
+    if(!dp)
+        return;
+    struct dirent* entry;
+    while((entry = readdir(dp)) != nullptr) {
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        std::string sub = dir + "/" + entry->d_name;
+        struct stat st;
+        if(stat((root_ + sub).c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            watchTree_(sub);
+    }
+    closedir(dp);
+}
+
+void FileWatcher::notify_(const std::string& path, bool isDir) {
+    for(auto& cb: subscribers_)
+        cb(path, isDir);
+}
+
+void FileWatcher::handleEvents() {
+    // Buffer aligned for struct inotify_event as suggested by inotify(7)
+    char buff[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    std::lock_guard<std::mutex> locker(mtx_);
+    while(true) {
+        ssize_t len = read(inotifyFd_, buff, sizeof(buff));
+        if(len <= 0)
+            break;
+        for(char* ptr = buff; ptr < buff + len; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if(event->mask & IN_Q_OVERFLOW) {
+                // Events are lost, so everything under the root may be stale.
+                LOG_WARN("inotify queue overflow");
+                notify_("", true);
+                continue;
+            }
+            auto it = wdPath_.find(event->wd);
+            if(it == wdPath_.end())
+                continue;
+            if(event->mask & IN_IGNORED) {
+                wdPath_.erase(it);
+                continue;
+            }
+            std::string path = it->second;
+            if(event->len)
+                path += std::string("/") + event->name;
+            bool isDir = event->mask & IN_ISDIR;
+            if(isDir && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                watchTree_(path);
+            LOG_DEBUG("FileWatcher: %s changed (mask 0x%x)", path.c_str(), event->mask);
+            notify_(path, isDir || (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)));
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * @file        : filewatcher.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the declaration of the FileWatcher class, which is designed 
+ *                for watching a directory tree through inotify. It translates the inotify events 
+ *                into paths relative to the watched root and dispatches them to the subscribers, 
+ *                so that caches of the file system can be invalidated.
+ */
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include "../../log/log.h"
+
+/**
+ * @class FileWatcher
+ * @brief The FileWatcher class is used to watch changes of a directory tree.
+ * 
+ * This class provides functionalities to watch every directory under the root 
+ * and notify the subscribers with the path (relative to the root, beginning 
+ * with '/') of the changed file. The inotify File Descriptor is nonblocking 
+ * and is expected to be polled by the event loop of the server.
+ */
+class FileWatcher {
+public:
+    /**
+     * @brief Type definition for subscriber callbacks.
+     * @param path The path of the changed file, relative to the root.
+     * @param isDir Whether the changed file is a directory.
+     */
+    using Callback = std::function<void(const std::string& path, bool isDir)>;
+
+    static FileWatcher* Instance();
+
+    /**
+     * @brief Start watching the directory tree.
+     * @param root The root directory to be watched.
+     * @return A flag whether it succeeds.
+     */
+    bool init(const std::string& root);
+
+    /**
+     * @brief Get the inotify File Descriptor (-1 if not initialized).
+     */
+    int fd() const;
+
+    /**
+     * @brief Add a subscriber which is notified for every change.
+     * @param cb The callback of the subscriber.
+     */
+    void subscribe(Callback cb);
+
+    /**
+     * @brief Read the pending inotify events and dispatch them to subscribers.
+     */
+    void handleEvents();
+
+private:
+    FileWatcher();
+    ~FileWatcher();
+
+    /**
+     * @brief Watch the directory and all its subdirectories.
+     * @param dir The path of the directory relative to the root.
+     */
+    void watchTree_(const std::string& dir);
+
+    /**
+     * @brief Notify all subscribers.
+     */
+    void notify_(const std::string& path, bool isDir);
+
+    int inotifyFd_;
+    std::string root_;
+    std::unordered_map<int, std::string> wdPath_; // Map the watch descriptor to the directory.
+    std::vector<Callback> subscribers_;
+    std::mutex mtx_;
+
+    static const uint32_t WATCH_MASK;
+};
+
+#endif //FILE_WATCHER_H
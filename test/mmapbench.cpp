@@ -0,0 +1,115 @@
+/*
+ * @file        : mmapbench.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : The loopback benchmark of the file body, comparing the mappings of MmapCache with 
+ *                sendfile. Keep-alive clients GET a file from a running server, and the wall time 
+ *                and the CPU time of the server are reported. Build the server with MMAP_CAPACITY 
+ *                of WebServer set to 0 (sendfile) and to a capacity above the file size (mappings), 
+ *                and run the benchmark against each, such as:
+ *                  head -c 1048576 /dev/urandom > ../resources/m.bin
+ *                  ./mmapbench $(pidof server) /m.bin 8 300
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <fstream>
+
+// User and system time of the process in seconds, from /proc/<pid>/stat.
+static double CpuTime(int pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = stat.rfind(')');
+    assert(pos != std::string::npos);
+    unsigned long utime = 0, stime = 0;
+    // The fields after the command are state, ppid, ... utime (14th) and stime (15th).
+    sscanf(stat.c_str() + pos + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime);
+    return double(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+// GET the path `requests` times on one keep-alive connection, returning the bytes of the bodies.
+static long Client(int port, const std::string& path, int requests) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+    std::vector<char> buff(1 << 20);
+    std::string head;
+    long total = 0;
+    for(int i = 0; i < requests; i++) {
+        if(write(fd, request.data(), request.size()) != (ssize_t)request.size()) {
+            perror("write");
+            exit(1);
+        }
+        // Read the header, the rest of the read is the front of the body.
+        size_t end;
+        while((end = head.find("\r\n\r\n")) == std::string::npos) {
+            ssize_t len = read(fd, buff.data(), buff.size());
+            if(len <= 0) {
+                fprintf(stderr, "Connection closed after %d responses\n", i);
+                exit(1);
+            }
+            head.append(buff.data(), len);
+        }
+        if(head.compare(0, 12, "HTTP/1.1 200") != 0) {
+            fprintf(stderr, "%s\n", head.substr(0, head.find("\r\n")).c_str());
+            exit(1);
+        }
+        size_t field = head.find("Content-Length: ");
+        assert(field != std::string::npos && field < end);
+        long contentLen = atol(head.c_str() + field + 16);
+        long received = head.size() - end - 4;
+        while(received < contentLen) {
+            ssize_t len = read(fd, buff.data(), std::min<long>(buff.size(), contentLen - received));
+            assert(len > 0);
+            received += len;
+        }
+        head.clear();   // Nothing is pipelined, so nothing of the next response is read yet.
+        total += contentLen;
+    }
+    close(fd);
+    return total;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        fprintf(stderr, "Usage: %s server_pid path [clients] [requests] [port]\n", argv[0]);
+        return 1;
+    }
+    int pid = atoi(argv[1]);
+    std::string path = argv[2];
+    int clients = argc > 3 ? atoi(argv[3]) : 8;
+    int requests = argc > 4 ? atoi(argv[4]) : 300;
+    int port = argc > 5 ? atoi(argv[5]) : 1316;
+
+    Client(port, path, 8);     // Warm up the caches, the file is mapped after MMAP_HOT_HITS requests.
+    std::atomic<long> bytes(0);
+    double cpu = CpuTime(pid);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int i = 0; i < clients; i++)
+        threads.emplace_back([&]() { bytes += Client(port, path, requests); });
+    for(auto& thread: threads)
+        thread.join();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cpu = CpuTime(pid) - cpu;
+    printf("mmapbench: %d clients x %d GETs of %s, %ld MB in %.2f s, server cpu %.2f s\n",
+           clients, requests, path.c_str(), bytes / (1024 * 1024), wall, cpu);
+}
@@ -0,0 +1,16 @@
+/*
+ * @file        : errmsg.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : The client error codes used by SqlStmt and the stub, see mysql.h of the stub.
+ */
+
+#ifndef MYSQL_STUB_ERRMSG_H
+#define MYSQL_STUB_ERRMSG_H
+
+#define CR_CONN_HOST_ERROR 2003
+#define CR_SERVER_GONE_ERROR 2006
+#define CR_SERVER_LOST 2013
+
+#endif /* MYSQL_STUB_ERRMSG_H */
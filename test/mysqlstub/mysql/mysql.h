@@ -0,0 +1,117 @@
+/*
+ * @file        : mysql.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the part of the MySQL client API used by SqlConnPool, SqlStmt and
+ *                SqlAsync, with the nonblocking API of MariaDB Connector/C, implemented by mysqlstub.c
+ *                without a server, for the tests of the pools.
+ */
+
+#ifndef MYSQL_STUB_H
+#define MYSQL_STUB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The nonblocking API of MariaDB Connector/C is stubbed too, see SqlAsync. */
+#define MARIADB_BASE_VERSION "mariadb-stub"
+
+typedef char my_bool;
+
+typedef struct st_mysql {
+    int open;           /* Connected by mysql_real_connect */
+    int client;         /* The socket of the client, a socketpair with the server (-1 if not connected) */
+    int server;         /* The end of the server, which writes a byte as the reply of each operation */
+    unsigned int timeout;       /* MYSQL_OPT_READ_TIMEOUT in seconds */
+    unsigned int err;
+} MYSQL;
+
+enum enum_field_types { MYSQL_TYPE_LONG = 3, MYSQL_TYPE_VAR_STRING = 253, MYSQL_TYPE_STRING = 254 };
+
+typedef struct st_mysql_bind {
+    unsigned long* length;
+    my_bool* is_null;
+    void* buffer;
+    my_bool* error;
+    enum enum_field_types buffer_type;
+    unsigned long buffer_length;
+} MYSQL_BIND;
+
+typedef struct st_mysql_stmt {
+    MYSQL* mysql;
+    unsigned long param_count;  /* The '?' in the query prepared */
+    unsigned int field_count;   /* 1 for a SELECT, which returns the first parameter as its row */
+    MYSQL_BIND* params;
+    MYSQL_BIND* results;
+    char row[256];              /* The field of the row executed */
+    unsigned long row_length;
+    int fetched;
+    unsigned int err;
+} MYSQL_STMT;
+
+enum mysql_option { MYSQL_OPT_CONNECT_TIMEOUT = 0, MYSQL_OPT_READ_TIMEOUT = 11, MYSQL_OPT_WRITE_TIMEOUT = 12,
+                    MYSQL_OPT_RECONNECT = 20, MYSQL_OPT_NONBLOCK = 6000 };
+
+#define MYSQL_NO_DATA 100
+#define MYSQL_DATA_TRUNCATED 101
+
+/* The status of the nonblocking calls, what the operation waits for */
+#define MYSQL_WAIT_READ 1
+#define MYSQL_WAIT_WRITE 2
+#define MYSQL_WAIT_EXCEPT 4
+#define MYSQL_WAIT_TIMEOUT 8
+
+int mysql_library_init(int argc, char** argv, char** groups);
+void mysql_library_end(void);
+MYSQL* mysql_init(MYSQL* mysql);
+int mysql_options(MYSQL* mysql, enum mysql_option option, const void* arg);
+MYSQL* mysql_real_connect(MYSQL* mysql, const char* host, const char* user, const char* passwd,
+                          const char* db, unsigned int port, const char* unix_socket, unsigned long flags);
+int mysql_ping(MYSQL* mysql);
+void mysql_close(MYSQL* mysql);
+unsigned int mysql_errno(MYSQL* mysql);
+const char* mysql_error(MYSQL* mysql);
+
+MYSQL_STMT* mysql_stmt_init(MYSQL* mysql);
+int mysql_stmt_prepare(MYSQL_STMT* stmt, const char* query, unsigned long length);
+unsigned long mysql_stmt_param_count(MYSQL_STMT* stmt);
+unsigned int mysql_stmt_field_count(MYSQL_STMT* stmt);
+my_bool mysql_stmt_bind_param(MYSQL_STMT* stmt, MYSQL_BIND* bind);
+my_bool mysql_stmt_bind_result(MYSQL_STMT* stmt, MYSQL_BIND* bind);
+int mysql_stmt_execute(MYSQL_STMT* stmt);
+int mysql_stmt_store_result(MYSQL_STMT* stmt);
+int mysql_stmt_fetch(MYSQL_STMT* stmt);
+int mysql_stmt_fetch_column(MYSQL_STMT* stmt, MYSQL_BIND* bind, unsigned int column, unsigned long offset);
+my_bool mysql_stmt_free_result(MYSQL_STMT* stmt);
+my_bool mysql_stmt_close(MYSQL_STMT* stmt);
+unsigned int mysql_stmt_errno(MYSQL_STMT* stmt);
+const char* mysql_stmt_error(MYSQL_STMT* stmt);
+
+int mysql_get_socket(const MYSQL* mysql);
+unsigned int mysql_get_timeout_value_ms(const MYSQL* mysql);
+int mysql_real_connect_start(MYSQL** ret, MYSQL* mysql, const char* host, const char* user, const char* passwd,
+                             const char* db, unsigned int port, const char* unix_socket, unsigned long flags);
+int mysql_real_connect_cont(MYSQL** ret, MYSQL* mysql, int status);
+int mysql_stmt_prepare_start(int* ret, MYSQL_STMT* stmt, const char* query, unsigned long length);
+int mysql_stmt_prepare_cont(int* ret, MYSQL_STMT* stmt, int status);
+int mysql_stmt_execute_start(int* ret, MYSQL_STMT* stmt);
+int mysql_stmt_execute_cont(int* ret, MYSQL_STMT* stmt, int status);
+int mysql_stmt_store_result_start(int* ret, MYSQL_STMT* stmt);
+int mysql_stmt_store_result_cont(int* ret, MYSQL_STMT* stmt, int status);
+
+/* Of the stub only: the connections open, checked by the tests after the pool is closed. */
+int mysql_stub_open_count(void);
+
+/* Of the stub only: the faults of the next connects, executions and nonblocking operations. */
+void mysql_stub_refuse(int count);      /* The next count connects fail */
+void mysql_stub_lose(int count);        /* The next count nonblocking executions lose the connection */
+void mysql_stub_hang(int count);        /* The next count nonblocking operations get no reply */
+void mysql_stub_timeout_ms(unsigned int ms);   /* The timeout of the waits, 0 for MYSQL_OPT_READ_TIMEOUT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MYSQL_STUB_H */
@@ -0,0 +1,15 @@
+/*
+ * @file        : mysqld_error.h
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : The server error codes used by SqlStmt, see mysql.h of the stub.
+ */
+
+#ifndef MYSQL_STUB_MYSQLD_ERROR_H
+#define MYSQL_STUB_MYSQLD_ERROR_H
+
+#define ER_DUP_ENTRY 1062
+#define ER_UNKNOWN_STMT_HANDLER 1243
+
+#endif /* MYSQL_STUB_MYSQLD_ERROR_H */
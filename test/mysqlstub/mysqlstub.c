@@ -0,0 +1,266 @@
+/*
+ * @file        : mysqlstub.c
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : This file contains the implementation of the MySQL client stub of mysql.h, which
+ *                connects at once and runs each statement in memory, so the pool can be tested
+ *                under contention without a server. The nonblocking operations wait for a byte
+ *                written on a socketpair as the reply of the server, so they are driven by epoll,
+ *                and the faults set by mysql_stub_* make them fail, lose the connection or hang.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "mysql/mysql.h"
+#include "mysql/errmsg.h"
+
+static int openCount = 0;   /* Atomic, the pool connects in parallel */
+static int refuseCount = 0; /* The faults left, see mysql.h */
+static int loseCount = 0;
+static int hangCount = 0;
+static unsigned int timeoutMS = 0;
+
+/* Take one of the faults left, returning whether there was one. */
+static int take_(int* count) {
+    int n = __atomic_load_n(count, __ATOMIC_RELAXED);
+    while(n > 0 && !__atomic_compare_exchange_n(count, &n, n - 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    return n > 0;
+}
+
+/* Open the socketpair of the connection, returning 0 if the connect is refused. */
+static int connect_(MYSQL* mysql) {
+    int fds[2];
+    if(take_(&refuseCount) || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        mysql->err = CR_CONN_HOST_ERROR;
+        return 0;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    mysql->client = fds[0];
+    mysql->server = fds[1];
+    mysql->err = 0;
+    return 1;
+}
+
+static void disconnect_(MYSQL* mysql) {
+    if(mysql->client >= 0)
+        close(mysql->client);
+    if(mysql->server >= 0)
+        close(mysql->server);
+    mysql->client = mysql->server = -1;
+    if(mysql->open)
+        __atomic_sub_fetch(&openCount, 1, __ATOMIC_RELAXED);
+    mysql->open = 0;
+}
+
+/* Start a nonblocking operation, the server replies at once unless the operation hangs. */
+static int start_(MYSQL* mysql) {
+    if(!take_(&hangCount) && mysql->server >= 0)
+        write(mysql->server, "", 1);
+    return MYSQL_WAIT_READ | MYSQL_WAIT_TIMEOUT;
+}
+
+/* Continue a nonblocking operation: 0 if the reply is read, -1 if timed out or the server is
+   gone, otherwise the status to wait for again. */
+static int cont_(MYSQL* mysql, int status) {
+    char reply;
+    ssize_t len;
+    if(status & MYSQL_WAIT_TIMEOUT)
+        return -1;
+    len = read(mysql->client, &reply, 1);
+    if(len == 1)
+        return 0;
+    return len < 0 && errno == EAGAIN ? MYSQL_WAIT_READ | MYSQL_WAIT_TIMEOUT : -1;
+}
+
+/* Finish the nonblocking operation of the statement, losing the connection if the server is gone. */
+static int stmtCont_(int* ret, MYSQL_STMT* stmt, int status) {
+    status = cont_(stmt->mysql, status);
+    if(status > 0)
+        return status;
+    stmt->err = status < 0 ? CR_SERVER_LOST : 0;
+    if(status < 0)
+        disconnect_(stmt->mysql);
+    *ret = status < 0;
+    return 0;
+}
+
+int mysql_library_init(int argc, char** argv, char** groups) { return 0; }
+void mysql_library_end(void) {}
+
+MYSQL* mysql_init(MYSQL* mysql) {
+    mysql = mysql ? mysql : (MYSQL*)calloc(1, sizeof(MYSQL));
+    if(mysql)
+        mysql->client = mysql->server = -1;
+    return mysql;
+}
+
+int mysql_options(MYSQL* mysql, enum mysql_option option, const void* arg) {
+    if(option == MYSQL_OPT_READ_TIMEOUT)
+        mysql->timeout = *(const unsigned int*)arg;
+    return 0;
+}
+
+MYSQL* mysql_real_connect(MYSQL* mysql, const char* host, const char* user, const char* passwd,
+                          const char* db, unsigned int port, const char* unix_socket, unsigned long flags) {
+    if(!connect_(mysql))
+        return NULL;
+    mysql->open = 1;
+    __atomic_add_fetch(&openCount, 1, __ATOMIC_RELAXED);
+    return mysql;
+}
+
+int mysql_ping(MYSQL* mysql) { return mysql->open ? 0 : 1; }
+
+void mysql_close(MYSQL* mysql) {
+    disconnect_(mysql);
+    free(mysql);
+}
+
+unsigned int mysql_errno(MYSQL* mysql) { return mysql->err; }
+const char* mysql_error(MYSQL* mysql) { return mysql->err ? "Can't connect to the stub" : ""; }
+
+int mysql_stub_open_count(void) { return __atomic_load_n(&openCount, __ATOMIC_RELAXED); }
+void mysql_stub_refuse(int count) { __atomic_store_n(&refuseCount, count, __ATOMIC_RELAXED); }
+void mysql_stub_lose(int count) { __atomic_store_n(&loseCount, count, __ATOMIC_RELAXED); }
+void mysql_stub_hang(int count) { __atomic_store_n(&hangCount, count, __ATOMIC_RELAXED); }
+void mysql_stub_timeout_ms(unsigned int ms) { __atomic_store_n(&timeoutMS, ms, __ATOMIC_RELAXED); }
+
+int mysql_get_socket(const MYSQL* mysql) { return mysql->client; }
+
+unsigned int mysql_get_timeout_value_ms(const MYSQL* mysql) {
+    unsigned int ms = __atomic_load_n(&timeoutMS, __ATOMIC_RELAXED);
+    return ms ? ms : mysql->timeout * 1000;
+}
+
+int mysql_real_connect_start(MYSQL** ret, MYSQL* mysql, const char* host, const char* user, const char* passwd,
+                             const char* db, unsigned int port, const char* unix_socket, unsigned long flags) {
+    if(!connect_(mysql)) {
+        *ret = NULL;
+        return 0;
+    }
+    return start_(mysql);
+}
+
+int mysql_real_connect_cont(MYSQL** ret, MYSQL* mysql, int status) {
+    status = cont_(mysql, status);
+    if(status > 0)
+        return status;
+    *ret = NULL;
+    if(status < 0) {
+        disconnect_(mysql);
+        mysql->err = CR_CONN_HOST_ERROR;
+        return 0;
+    }
+    mysql->open = 1;
+    __atomic_add_fetch(&openCount, 1, __ATOMIC_RELAXED);
+    *ret = mysql;
+    return 0;
+}
+
+MYSQL_STMT* mysql_stmt_init(MYSQL* mysql) {
+    MYSQL_STMT* stmt = (MYSQL_STMT*)calloc(1, sizeof(MYSQL_STMT));
+    if(stmt)
+        stmt->mysql = mysql;
+    return stmt;
+}
+
+int mysql_stmt_prepare(MYSQL_STMT* stmt, const char* query, unsigned long length) {
+    unsigned long i;
+    stmt->param_count = 0;
+    for(i = 0; i < length; i++)
+        stmt->param_count += query[i] == '?';
+    stmt->field_count = length >= 6 && strncmp(query, "SELECT", 6) == 0;
+    return 0;
+}
+
+unsigned long mysql_stmt_param_count(MYSQL_STMT* stmt) { return stmt->param_count; }
+unsigned int mysql_stmt_field_count(MYSQL_STMT* stmt) { return stmt->field_count; }
+
+my_bool mysql_stmt_bind_param(MYSQL_STMT* stmt, MYSQL_BIND* bind) {
+    stmt->params = bind;
+    return 0;
+}
+
+my_bool mysql_stmt_bind_result(MYSQL_STMT* stmt, MYSQL_BIND* bind) {
+    stmt->results = bind;
+    return 0;
+}
+
+int mysql_stmt_execute(MYSQL_STMT* stmt) {
+    if(!stmt->mysql->open)
+        return 1;
+    stmt->row_length = 0;
+    if(stmt->param_count > 0) {
+        unsigned long len = *stmt->params[0].length;
+        stmt->row_length = len < sizeof(stmt->row) ? len : sizeof(stmt->row);
+        memcpy(stmt->row, stmt->params[0].buffer, stmt->row_length);
+    }
+    stmt->fetched = 0;
+    return 0;
+}
+
+int mysql_stmt_store_result(MYSQL_STMT* stmt) { return 0; }
+
+int mysql_stmt_prepare_start(int* ret, MYSQL_STMT* stmt, const char* query, unsigned long length) {
+    mysql_stmt_prepare(stmt, query, length);
+    return start_(stmt->mysql);
+}
+
+int mysql_stmt_prepare_cont(int* ret, MYSQL_STMT* stmt, int status) { return stmtCont_(ret, stmt, status); }
+
+int mysql_stmt_execute_start(int* ret, MYSQL_STMT* stmt) {
+    if(take_(&loseCount) && stmt->mysql->server >= 0) {
+        /* The server goes away, so the socket reads the end of file. */
+        close(stmt->mysql->server);
+        stmt->mysql->server = -1;
+        return MYSQL_WAIT_READ | MYSQL_WAIT_TIMEOUT;
+    }
+    if(mysql_stmt_execute(stmt)) {
+        stmt->err = CR_SERVER_GONE_ERROR;
+        *ret = 1;
+        return 0;
+    }
+    return start_(stmt->mysql);
+}
+
+int mysql_stmt_execute_cont(int* ret, MYSQL_STMT* stmt, int status) { return stmtCont_(ret, stmt, status); }
+
+int mysql_stmt_store_result_start(int* ret, MYSQL_STMT* stmt) { return start_(stmt->mysql); }
+
+int mysql_stmt_store_result_cont(int* ret, MYSQL_STMT* stmt, int status) { return stmtCont_(ret, stmt, status); }
+
+int mysql_stmt_fetch(MYSQL_STMT* stmt) {
+    MYSQL_BIND* bind = stmt->results;
+    if(!stmt->field_count || stmt->fetched)
+        return MYSQL_NO_DATA;
+    stmt->fetched = 1;
+    *bind->length = stmt->row_length;
+    if(bind->is_null)
+        *bind->is_null = 0;
+    memcpy(bind->buffer, stmt->row, stmt->row_length < bind->buffer_length ? stmt->row_length : bind->buffer_length);
+    return stmt->row_length > bind->buffer_length ? MYSQL_DATA_TRUNCATED : 0;
+}
+
+int mysql_stmt_fetch_column(MYSQL_STMT* stmt, MYSQL_BIND* bind, unsigned int column, unsigned long offset) {
+    memcpy(bind->buffer, stmt->row + offset, stmt->row_length - offset < bind->buffer_length
+                                             ? stmt->row_length - offset : bind->buffer_length);
+    return 0;
+}
+
+my_bool mysql_stmt_free_result(MYSQL_STMT* stmt) {
+    stmt->fetched = 1;
+    return 0;
+}
+
+my_bool mysql_stmt_close(MYSQL_STMT* stmt) {
+    free(stmt);
+    return 0;
+}
+
+unsigned int mysql_stmt_errno(MYSQL_STMT* stmt) { return stmt->err; }
+const char* mysql_stmt_error(MYSQL_STMT* stmt) { return stmt->err ? "Lost connection to the stub" : ""; }
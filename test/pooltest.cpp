@@ -0,0 +1,167 @@
+/*
+ * @file        : pooltest.cpp
+ * @Author      : zhenxi
+ * @Date        : 2026-10-19
+ * @copyleft    : Apache 2.0
+ * Description  : The tests of SqlConnPool under contention and of the states of SqlAsync, built
+ *                against the MySQL client stub of mysqlstub/, see the pool target of the Makefile.
+ */
+#include "../code/pool/sqlconnRAII.h"
+#include "../code/pool/sqlasync.h"
+#include <poll.h>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+
+void TestPool(bool affine) {
+    // Twice as many threads as connections, each connection must have one holder at most.
+    const int THREADS = 24, CONNS = 12, LOOPS = 20000;
+    SqlConnPool* pool = SqlConnPool::Instance();
+    pool->Init("localhost", 3306, "root", "root", "webserver", CONNS, 2, 1000, affine);
+
+    std::mutex mtx;
+    std::unordered_map<MYSQL*, int> holders;
+    auto hold = [&](MYSQL* sql, int n) {
+        std::lock_guard<std::mutex> locker(mtx);
+        int& count = holders[sql];
+        count += n;
+        assert(count == 0 || count == 1);
+    };
+    std::atomic<int> failed(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int i = 0; i < THREADS; i++) {
+        threads.emplace_back([&, i]() {
+            for(int j = 0; j < LOOPS; j++) {
+                MYSQL* sql;
+                SqlConnRAII conn(&sql, pool);
+                if(!sql) {
+                    failed++;
+                    continue;
+                }
+                hold(sql, 1);
+                std::string name = "T" + std::to_string(i) + "L" + std::to_string(j);
+                SqlResult result = pool->Execute(sql, "SELECT ?", { name });
+                assert(result.ok && result.rows.size() == 1 && result.rows[0][0] == name);
+                if(i == 0) {
+                    // One thread holds two, freeing the one not in its slot, which is searched for.
+                    MYSQL* other;
+                    SqlConnRAII conn2(&other, pool);
+                    assert(other && other != sql);
+                    hold(other, 1);
+                    hold(other, -1);
+                }
+                hold(sql, -1);
+            }
+        });
+    }
+    for(auto& thread: threads)
+        thread.join();
+    long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    assert(failed == 0 && pool->TimeoutCount() == 0);
+    assert(pool->OpenCount() <= CONNS && mysql_stub_open_count() == pool->OpenCount());
+    pool->ClosePool();
+    assert(pool->OpenCount() == 0 && mysql_stub_open_count() == 0);
+    printf("TestPool: %d threads on %d connections%s, %d acquires in %ld ms\n",
+           THREADS, CONNS, affine ? " (affine)" : "", THREADS * LOOPS, ms);
+}
+
+// Run the event loop of SqlAsync as WebServer does, until the condition holds or the time is out.
+static bool RunAsync(const std::function<bool()>& done, int timeoutMS) {
+    SqlAsync* async = SqlAsync::Instance();
+    TimeStamp end = Clock::now() + MS(timeoutMS);
+    while(!done()) {
+        int remainMS = std::chrono::duration_cast<MS>(end - Clock::now()).count();
+        if(remainMS <= 0)
+            return false;
+        int timeMS = async->handleTimeouts();
+        pollfd fd = { async->fd(), POLLIN, 0 };
+        poll(&fd, 1, timeMS >= 0 && timeMS < remainMS ? timeMS : remainMS);
+        async->handleEvents();
+    }
+    return true;
+}
+
+void TestSqlAsync() {
+    SqlAsync* async = SqlAsync::Instance();
+    std::vector<SqlAsync::Result> results;
+    auto query = [&](const std::string& name) {
+        async->query("SELECT ?", { name }, [&](const SqlAsync::Result& result) { results.push_back(result); });
+    };
+    auto answered = [&](size_t count) { return [&, count]() { return results.size() >= count; }; };
+    auto connected = [](int count) { return [count]() { return mysql_stub_open_count() == count; }; };
+
+    // One of the two connections is refused, so it is BROKEN and connected again after the delay.
+    mysql_stub_refuse(1);
+    assert(async->init("localhost", 3306, "root", "root", "webserver", 2) && async->fd() >= 0);
+    assert(mysql_stub_open_count() == 1);
+
+    // A query is prepared, executed and stored, and the next one of the same SQL is executed at once.
+    query("a");
+    query("b");
+    assert(RunAsync(answered(2), 1000));
+    assert(results[0].ok && results[0].rows.size() == 1 && results[0].rows[0][0] == "a");
+    assert(results[1].ok && results[1].rows[0][0] == "b");
+    assert(RunAsync(connected(2), 3000));
+
+    // A connection lost while executing is connected again, and the query is run once more.
+    results.clear();
+    mysql_stub_lose(1);
+    query("c");
+    assert(RunAsync(answered(1), 1000) && results[0].ok && results[0].rows[0][0] == "c");
+    assert(RunAsync(connected(2), 1000));
+    // Lost again when it is run once more, it fails.
+    results.clear();
+    mysql_stub_lose(2);
+    query("d");
+    assert(RunAsync(answered(1), 1000) && !results[0].ok && results[0].errnum == CR_SERVER_LOST);
+    assert(RunAsync(connected(2), 1000));
+
+    // An operation without a reply times out, which is taken as a connection lost.
+    results.clear();
+    mysql_stub_timeout_ms(100);
+    mysql_stub_hang(1);
+    auto start = Clock::now();
+    query("e");
+    assert(RunAsync(answered(1), 2000) && results[0].ok && results[0].rows[0][0] == "e");
+    assert(Clock::now() - start >= MS(100));
+    // Every operation hangs, the connects too, so the query and the one run again time out.
+    results.clear();
+    mysql_stub_hang(1000);
+    query("f");
+    assert(RunAsync(answered(1), 2000) && !results[0].ok && results[0].errnum == CR_SERVER_LOST);
+    mysql_stub_hang(0);
+    assert(RunAsync(connected(2), 5000));
+
+    // With the connections busy longer than the timeout, the queued query fails without running.
+    results.clear();
+    mysql_stub_timeout_ms(6000);
+    mysql_stub_hang(2);
+    start = Clock::now();
+    query("g");
+    query("h");
+    query("i");
+    assert(RunAsync(answered(1), 6000) && results[0].errnum == CR_SERVER_GONE_ERROR);
+    assert(Clock::now() - start >= std::chrono::seconds(5));
+    // The two busy ones time out and run again on the connections connected again.
+    assert(RunAsync(answered(3), 3000) && results[1].ok && results[2].ok);
+    mysql_stub_timeout_ms(0);
+
+    async->close();
+    assert(async->fd() < 0 && mysql_stub_open_count() == 0);
+    results.clear();
+    query("j");
+    assert(results.size() == 1 && results[0].errnum == CR_SERVER_GONE_ERROR);
+    printf("TestSqlAsync: ok\n");
+}
+
+int main(int argc, char** argv) {
+    // The pool is a singleton and is closed after a run, so each mode runs in its own process.
+    bool affine = argc < 2 || strcmp(argv[1], "shared") != 0;
+    Log::Instance()->init(1, "./testpool", ".log", 1024);
+    if(argc > 1 && strcmp(argv[1], "async") == 0)
+        TestSqlAsync();
+    else
+        TestPool(affine);
+}
@@ -5,7 +5,14 @@
  */ 
 #include "../code/log/log.h"
 #include "../code/pool/threadpool.h"
+#include "../code/http/httpresponse.h"
+#include "../code/http/httprequest.h"
+#include "../code/http/radixtree.h"
 #include <features.h>
+#include <dirent.h>
+#include <chrono>
+#include <fstream>
+#include <vector>
 
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ < 30
 #include <sys/syscall.h>
@@ -50,7 +57,273 @@ void TestThreadPool() {
     getchar();
 }
 
+// Wait until the writer has drained the lines into the files of the directory.
+static std::vector<std::string> ReadLogLines(const std::string& dir, size_t expected, int& files) {
+    std::vector<std::string> lines;
+    for(int wait = 0; wait < 100; wait++) {
+        lines.clear();
+        files = 0;
+        DIR* d = opendir(dir.c_str());
+        assert(d);
+        while(dirent* entry = readdir(d)) {
+            if(entry->d_name[0] == '.')
+                continue;
+            files++;
+            std::ifstream file(dir + "/" + entry->d_name);
+            for(std::string line; std::getline(file, line); )
+                lines.push_back(line);
+        }
+        closedir(d);
+        if(lines.size() >= expected)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return lines;
+}
+
+void TestLogRings() {
+    // Small rings wrap and fill up often, and the threads exit, leaving their rings to the writer.
+    const int THREADS = 8, LINES = 10000;
+    system("rm -rf ./testlogring");
+    Log::Instance()->init(0, "./testlogring", ".log", 16);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(int i = 0; i < THREADS; i++) {
+        threads.emplace_back([i]() {
+            for(int j = 0; j < LINES; j++) {
+                if(j % 1000 == 0) {     // Cut to the max size of a line
+                    LOG_INFO("T%d L%d long %s", i, j, std::string(8000, 'x').c_str());
+                }
+                else {
+                    LOG_INFO("T%d L%d end", i, j);
+                }
+            }
+        });
+    }
+    for(auto& thread: threads)
+        thread.join();
+    long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    int files;
+    std::vector<std::string> lines = ReadLogLines("./testlogring", THREADS * LINES, files);
+    assert(lines.size() == THREADS * LINES);
+    std::vector<std::vector<bool>> seen(THREADS, std::vector<bool>(LINES));
+    for(auto& line: lines) {
+        int i, j, len;
+        char tail[8];
+        const char* msg = strstr(line.c_str(), "[info] : ");
+        assert(msg && sscanf(msg, "[info] : T%d L%d %4s%n", &i, &j, tail, &len) == 3);
+        assert(i >= 0 && i < THREADS && j >= 0 && j < LINES && !seen[i][j]);
+        assert(strcmp(tail, "end") == 0 ? msg[len] == '\0' : strcmp(tail, "long") == 0 && line.size() < 4096);
+        seen[i][j] = true;
+    }
+    // More than MAX_LINES lines of the day are rotated into a second file.
+    assert(files >= 2);
+    printf("TestLogRings: %d lines of %d threads in %ld ms\n", THREADS * LINES, THREADS, ms);
+}
+
+// Drain the streamed body as the write loop of HttpConn does, a chunk once the previous one is sent.
+static std::string DrainStream(HttpResponse& response, Buffer& buff) {
+    std::string out;
+    do {
+        out.append(buff.data(), buff.size());
+        buff.delData(buff.size());
+    } while(response.nextChunk(buff));
+    return out;
+}
+
+void TestStream() {
+    // More than a chunk of pieces, so the body is framed as several chunks.
+    const int PIECES = 5000;
+    std::string body;
+    for(int i = 0; i < PIECES; i++)
+        body += "line " + std::to_string(i) + "\n";
+    auto producer = []() {
+        return [i = 0](Buffer& buff) mutable {
+            std::string piece = "line " + std::to_string(i) + "\n";
+            buff.addData(piece.data(), piece.size());
+            return ++i < PIECES;
+        };
+    };
+
+    HttpResponse response;
+    Buffer buff;
+    response.addStream(producer(), true);
+    response.makeMessage(buff, 200);
+    std::string out = DrainStream(response, buff);
+    assert(!response.streaming() && !response.nextChunk(buff));
+    size_t pos = out.find("\r\n\r\n");
+    assert(pos != std::string::npos && out.substr(0, pos).find("Transfer-Encoding: chunked") != std::string::npos);
+    // Decode the chunks, the zero-length one ends the body and nothing follows it.
+    std::string decoded;
+    int chunks = 0;
+    for(pos += 4; ; chunks++) {
+        size_t end = out.find("\r\n", pos);
+        assert(end != std::string::npos);
+        size_t len = std::stoul(out.substr(pos, end - pos), nullptr, 16);
+        pos = end + 2;
+        if(len == 0) {
+            assert(out.compare(pos, std::string::npos, "\r\n") == 0);
+            break;
+        }
+        assert(out.compare(pos + len, 2, "\r\n") == 0);
+        decoded.append(out, pos, len);
+        pos += len + 2;
+    }
+    assert(decoded == body && chunks > 1);
+
+    // Unframed for HTTP/1.0, the body ends where the stream does and closing the connection marks it.
+    response.clear();
+    response.addStream(producer(), false);
+    response.makeMessage(buff, 200);
+    out = DrainStream(response, buff);
+    assert(!response.streaming() && !response.nextChunk(buff));
+    pos = out.find("\r\n\r\n");
+    assert(pos != std::string::npos && out.substr(0, pos).find("Transfer-Encoding") == std::string::npos);
+    assert(out.substr(pos + 4) == body);
+    printf("TestStream: %zu bytes in %d chunks\n", body.size(), chunks);
+}
+
+void TestRadixTree() {
+    RadixTree<int> tree;
+    tree.insert("/user/:id", 1);
+    tree.insert("/user/me", 2);
+    tree.insert("/user/*rest", 3);
+    tree.insert("/user/me/profile", 4);
+    tree.insert("/user/:id/posts", 5);
+    auto match = [&tree](std::string_view path, RadixTree<int>::Params& params) {
+        params.clear();
+        const int* value = tree.match(path, params);
+        return value ? *value : 0;
+    };
+    RadixTree<int>::Params params;
+    // Static segments before parameters, and parameters before wildcards.
+    assert(match("/user/me", params) == 2 && params.empty());
+    assert(match("/user/42", params) == 1 && params.size() == 1);
+    assert(params[0].first == "id" && params[0].second == "42");
+    assert(match("/user/me/profile", params) == 4 && params.empty());
+    // The static branch "me" fails on "/posts", which backtracks to the parameter.
+    assert(match("/user/me/posts", params) == 5 && params.size() == 1 && params[0].second == "me");
+    // The parameter fails on the rest, which backtracks to the wildcard without its capture.
+    assert(match("/user/42/x/y", params) == 3 && params.size() == 1);
+    assert(params[0].first == "rest" && params[0].second == "42/x/y");
+    assert(match("/user/", params) == 3 && params.size() == 1 && params[0].second.empty());
+    assert(match("/use", params) == 0 && params.empty());
+    assert(match("/other", params) == 0 && params.empty());
+
+    // A shorter prefix inserted after a longer one splits the node, twice here.
+    RadixTree<int> split;
+    split.insert("/abcdef", 1);
+    split.insert("/abc", 2);
+    split.insert("/abx", 3);
+    const int* value;
+    assert((value = split.match("/abcdef", params)) && *value == 1);
+    assert((value = split.match("/abc", params)) && *value == 2);
+    assert((value = split.match("/abx", params)) && *value == 3);
+    assert(!split.match("/ab", params) && !split.match("/abcde", params) && !split.match("/abcdefg", params));
+
+    // The query is not part of the path matched.
+    HttpRequest request;
+    Buffer buff;
+    buff.addData("GET /user/7/posts?page=2&id=8 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    assert(request.parse(buff) && request.path() == "/user/7/posts");
+    assert(match(request.path(), params) == 5 && params.size() == 1 && params[0].second == "7");
+    printf("TestRadixTree: ok\n");
+}
+
+void TestNotModified() {
+    // The entity tags are compared weakly, '*' alone is the wildcard and may be in a tag too.
+    auto check = [](const std::string& ifNoneMatch) {
+        HttpResponse response;
+        response.setValidators("\"abc\"", 100);
+        return response.checkNotModified(ifNoneMatch, "");
+    };
+    assert(check("*") && check(" * "));
+    assert(check("\"abc\"") && check("W/\"abc\"") && check("\"x\", W/\"abc\""));
+    assert(check("\"a,b\" ,\"abc\""));
+    assert(!check("W/\"a*b\"") && !check("\"abcd\"") && !check("\"ab\"") && !check("abc"));
+    assert(!check("\"x\", *"));
+    printf("TestNotModified: ok\n");
+}
+
+// Write the response to a string as the write loop of HttpConn does, range by range.
+static std::string WriteRanges(HttpResponse& response, Buffer& buff) {
+    std::string out;
+    do {
+        out.append(buff.data(), buff.size());
+        buff.delData(buff.size());
+        out.append(response.contentData() + response.contentOffset(), response.contentLen() - response.contentOffset());
+    } while(response.nextPart(buff));
+    return out;
+}
+
+static std::string HeaderOf(const std::string& message, const std::string& field) {
+    size_t pos = message.find("\r\n" + field + ": ");
+    if(pos == std::string::npos || pos > message.find("\r\n\r\n"))
+        return "";
+    pos += field.size() + 4;
+    return message.substr(pos, message.find("\r\n", pos) - pos);
+}
+
+void TestRanges() {
+    const std::string body = "0123456789abcdefghij";   // 20 bytes
+    // Respond the range request on the body, returning the status and the message written.
+    auto respond = [](const std::string& content, const std::string& range, std::string& message) {
+        std::shared_ptr<char> data(new char[content.size() + 1], std::default_delete<char[]>());
+        memcpy(data.get(), content.data(), content.size());
+        HttpResponse response;
+        Buffer buff;
+        response.addBody(data, content.size(), nullptr);
+        int code = response.setRanges(range, "text/plain");
+        response.makeMessage(buff, code);
+        message = WriteRanges(response, buff);
+        return code;
+    };
+    auto bodyOf = [](const std::string& message) { return message.substr(message.find("\r\n\r\n") + 4); };
+    std::string message;
+
+    assert(respond(body, "bytes=5-9", message) == 206 && bodyOf(message) == "56789");
+    assert(HeaderOf(message, "Content-Range") == "bytes 5-9/20" && HeaderOf(message, "Content-Length") == "5");
+    // Suffix ranges, the last N bytes or all of them if N is larger.
+    assert(respond(body, "bytes=-3", message) == 206 && bodyOf(message) == "hij");
+    assert(respond(body, "bytes=-100", message) == 206 && bodyOf(message) == body);
+    // Positions overflowing off64_t are saturated: past the end, or the end itself.
+    const std::string huge = "99999999999999999999999999";
+    assert(respond(body, "bytes=" + huge + "-", message) == 416);
+    assert(respond(body, "bytes=10-" + huge, message) == 206 && bodyOf(message) == body.substr(10));
+    assert(respond(body, "bytes=-" + huge, message) == 206 && bodyOf(message) == body);
+    // A reversed range makes the header invalid, so it is ignored.
+    assert(respond(body, "bytes=9-5", message) == 200);
+    // Nothing is satisfiable in an empty file, nor past the end.
+    assert(respond("", "bytes=-5", message) == 416 && HeaderOf(message, "Content-Range") == "bytes */0");
+    assert(respond(body, "bytes=20-,30-40", message) == 416);
+    assert(HeaderOf(message, "Content-Range") == "bytes */20" && bodyOf(message).empty());
+    // More than MAX_RANGES (16) ranges are ignored as an abuse.
+    std::string many = "bytes=0-0";
+    for(int i = 1; i < 17; i++)
+        many += "," + std::to_string(i) + "-" + std::to_string(i);
+    assert(respond(body, many, message) == 200);
+
+    // A multipart response is as long as its Content-Length, and has each part with its range.
+    assert(respond(body, "bytes=0-1, 5-6,-2", message) == 206);
+    std::string boundary = HeaderOf(message, "Content-Type");
+    assert(boundary.compare(0, 31, "multipart/byteranges; boundary=") == 0);
+    boundary = boundary.substr(31);
+    std::string parts = bodyOf(message);
+    assert(std::stoul(HeaderOf(message, "Content-Length")) == parts.size());
+    assert(parts == "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/20\r\n\r\n01"
+                  + "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 5-6/20\r\n\r\n56"
+                  + "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 18-19/20\r\n\r\nij"
+                  + "\r\n--" + boundary + "--\r\n");
+    printf("TestRanges: ok\n");
+}
+
 int main() {
     TestLog();
+    TestLogRings();
+    TestStream();
+    TestRadixTree();
+    TestNotModified();
+    TestRanges();
     TestThreadPool();
 }
\ No newline at end of file